@@ -27,34 +27,215 @@
 #include "memory_io.h"
 #include <string.h>
 
+/* Programs are staged here and issued together with MEMIO_progv_async(), so
+ * runs of consecutive pages reach the device as a single transfer. Two staging
+ * buffers are used: while one is being programmed, lfs keeps preparing the
+ * next pages into the other one. */
+#ifndef FS_PROG_BATCH_SIZE
+#define FS_PROG_BATCH_SIZE 1024
+#endif
+#define FS_PROG_BATCH_EXTENTS 4
+
+/* Upper bounds for the sizes derived from the device geometry. Caches grow by
+ * one page for every FS_CACHE_SCALE_SIZE bytes of device capacity. Both the
+ * cache and the batch size can be raised at build time: the memory I/O driver
+ * splits multi-page programs into page commands itself. */
+#ifndef FS_CACHE_SIZE_MAX
+#define FS_CACHE_SIZE_MAX 1024
+#endif
+#define FS_CACHE_SCALE_SIZE (2UL * 1024UL * 1024UL)
+#define FS_LOOKAHEAD_SIZE_MAX 128
+
+/* Appends smaller than the threshold are collected here, and reach their
+ * file together in a single lfs commit. */
+#ifndef FS_APPEND_BUFFER_SIZE
+#define FS_APPEND_BUFFER_SIZE 256
+#endif
+
+/* Directories recently found to exist, with their metadata pair, so that
+ * operations on files of hot directories neither look the directory up again
+ * nor make lfs walk its path from the root. Longer paths are not cached. */
+#ifndef FS_PATH_CACHE_ENTRIES
+#define FS_PATH_CACHE_ENTRIES 4
+#endif
+#define FS_PATH_CACHE_PATH_MAX 64
+
+/* Entries are copied straight from the lfs_info of littlefs. */
+#if FS_NAME_MAX != LFS_NAME_MAX
+#error "FS_NAME_MAX must match LFS_NAME_MAX"
+#endif
+
+/* Files that can be open at once through FS_open(). */
+#ifndef FS_FILES_MAX
+#define FS_FILES_MAX 4
+#endif
+
+/* Files a transaction can stage, each in a handle of its own. */
+#ifndef FS_TXN_FILES_MAX
+#define FS_TXN_FILES_MAX 4
+#endif
+
+/* Staged files that share a metadata pair are published by one commit, and
+ * temporary files are named after a single digit. */
+#if FS_TXN_FILES_MAX > LFS_SYNCV_MAX || FS_TXN_FILES_MAX > 10
+#error "FS_TXN_FILES_MAX must not exceed LFS_SYNCV_MAX nor 10"
+#endif
+
+/* Files spread over several metadata pairs are copied to temporary files in a
+ * reserved directory instead, which FS_list_dir() hides. A committed
+ * transaction is recorded in the journal until every temporary file has been
+ * renamed over its target, so that FS_init() can finish it after a power
+ * loss. */
+#define FS_TXN_DIR "/.txn"
+#define FS_TXN_JOURNAL_PATH FS_TXN_DIR "/journal"
+#define FS_TXN_MAGIC 0x4E585446U /* "FTXN" */
+#define FS_TXN_COPY_SIZE 64
+
+typedef struct {
+  uint8_t data[FS_PROG_BATCH_SIZE];
+  MEMIO_Extent_t extents[FS_PROG_BATCH_EXTENTS];
+  uint32_t count;
+  uint32_t used;
+} FS_Prog_Batch_t;
+
+/* Each handle has a static cache, so opening a file never allocates. */
+struct FS_File {
+  bool in_use;
+  lfs_file_t file;
+  struct lfs_file_config config;
+  uint8_t cache[FS_CACHE_SIZE_MAX];
+};
+
 static lfs_t lfs;
 lfs_file_t file;
 
+static FS_File_t files[FS_FILES_MAX];
+
+/* Staged files live outside the FS_open() pool, which stays free for the
+ * application. A slot is staged when its handle is in use. */
+static bool txn_active = false;
+static FS_File_t txn_files[FS_TXN_FILES_MAX];
+static char txn_paths[FS_TXN_FILES_MAX][LFS_NAME_MAX + 1];
+
+typedef struct {
+  uint32_t last_used; /* 0 for a free entry */
+  lfs_block_t pair[2];
+  char path[FS_PATH_CACHE_PATH_MAX + 1];
+} FS_Path_Cache_Entry_t;
+
+static FS_Path_Cache_Entry_t path_cache[FS_PATH_CACHE_ENTRIES];
+static uint32_t path_cache_clock = 0;
+
+static uint8_t append_buffer[FS_APPEND_BUFFER_SIZE];
+static size_t append_used = 0;
+static size_t append_threshold = FS_APPEND_BUFFER_SIZE;
+static char append_path[LFS_NAME_MAX + 1];
+
+/* Erases of consecutive blocks are queued and issued as one
+ * MEMIO_erase_range_async() call, which lets the driver use block or chip
+ * erase commands. */
+static lfs_block_t erase_queue_start = 0;
+static lfs_size_t erase_queue_count = 0;
+
+static FS_Stats_t stats;
+
+static FS_Trace_Callback_t trace_callback = NULL;
+static void *trace_context = NULL;
+
+static FS_Prog_Batch_t prog_batches[2];
+static FS_Prog_Batch_t *prog_batch = &prog_batches[0];
+
+/* At most one asynchronous operation is in flight. Its result is reported by
+ * the next block-device call that has to wait for it. */
+static bool device_in_flight = false;
+static uint32_t device_in_flight_start = 0;
+static uint32_t device_in_flight_end = 0;
+static MEMIO_Status_t device_status = MEMIO_Status_Ok;
+
 static int read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
                 void *buffer, lfs_size_t size);
+static int read_device(const struct lfs_config *c, uint32_t address,
+                       void *buffer, lfs_size_t size);
 static int prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
                 const void *buffer, lfs_size_t size);
 static int erase(const struct lfs_config *c, lfs_block_t block);
 static int sync(const struct lfs_config *c);
-
-static const struct lfs_config cfg = {
+static int crc(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+               lfs_size_t size, uint32_t *value);
+static int cmp(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+               const void *buffer, lfs_size_t size, int *res);
+static bool dir_lookup(const struct lfs_config *c, const char *path,
+                       lfs_size_t *len, lfs_block_t pair[2]);
+static void dir_relocate(const struct lfs_config *c,
+                         const lfs_block_t oldpair[2],
+                         const lfs_block_t newpair[2]);
+static void trace(FS_Trace_Op_t op, uint32_t address, uint32_t size,
+                  const void *data);
+static int prog_batch_submit(void);
+static int erase_queue_submit(const struct lfs_config *c);
+static int device_wait(void);
+static void device_reset(void);
+static int device_flush(const struct lfs_config *c);
+static int device_settle(const struct lfs_config *c, uint32_t address,
+                         uint32_t size, bool *suspended);
+static int device_resume(MEMIO_Status_t status);
+static bool device_pending_overlaps(const struct lfs_config *c,
+                                    uint32_t address, uint32_t size);
+
+static int config_from_geometry(struct lfs_config *c);
+static bool build_full_path(const char *directory_path, const char *file_name,
+                            char *full_path);
+static bool file_is_open(const FS_File_t *file);
+static void file_discard(FS_File_t *file);
+static bool directory_exists(const char *path);
+static FS_Path_Cache_Entry_t *path_cache_find(const char *path, size_t length);
+static void path_cache_insert(const char *path, const lfs_block_t pair[2]);
+static void path_cache_invalidate(void);
+static FS_Status_t open_file(const char *directory_path, const char *file_name,
+                             int flags);
+static FS_Status_t append_write(const char *full_path, const uint8_t *data,
+                                size_t size);
+static FS_Status_t txn_commit_journal(void);
+static void txn_temp_path(size_t index, char *temp_path);
+static bool txn_copy(lfs_file_t *source, const char *temp_path);
+static FS_Status_t txn_journal_write(size_t count);
+static FS_Status_t txn_apply(size_t count);
+static FS_Status_t txn_remove_staging(void);
+static FS_Status_t txn_recover(void);
+
+/* Sizes not fixed here are derived from the device geometry in FS_init(). */
+static struct lfs_config cfg = {
     .read = read,
     .prog = prog,
     .erase = erase,
     .sync = sync,
-    .read_size = 256,
-    .prog_size = 256,
-    .block_size = 4096,
-    .block_count = 512,
-    .cache_size = 256,
-    .lookahead_size = 16,
+    .crc = crc,
+    .cmp = cmp,
+    .dir_lookup = dir_lookup,
+    .dir_relocate = dir_relocate,
     .block_cycles = 100000,
 };
 
 FS_Status_t FS_init(void) {
-  int err = lfs_mount(&lfs, &cfg);
+  memset(&stats, 0, sizeof(stats));
+  memset(files, 0, sizeof(files));
+  memset(txn_files, 0, sizeof(txn_files));
+  txn_active = false;
+  path_cache_invalidate();
+  append_used = 0;
+  device_reset();
+
+  int err = config_from_geometry(&cfg);
+  if (err != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  err = lfs_mount(&lfs, &cfg);
   if (err != LFS_ERR_OK) {
     err = lfs_format(&lfs, &cfg);
+    if (err == LFS_ERR_OK) {
+      err = device_flush(&cfg);
+    }
     if (err != LFS_ERR_OK) {
       return FS_Status_Err;
     }
@@ -63,15 +244,30 @@ FS_Status_t FS_init(void) {
       return FS_Status_Err;
     }
   }
-  return FS_Status_Ok;
+  return txn_recover();
 }
 
 FS_Status_t FS_deinit(void) {
-  int err = lfs_unmount(&lfs);
+  FS_Status_t status = FS_flush_appends();
+  if (txn_active) {
+    FS_txn_abort();
+  }
+  for (size_t i = 0; i < FS_FILES_MAX; i++) {
+    if (files[i].in_use && FS_close(&files[i]) != FS_Status_Ok) {
+      status = FS_Status_Err;
+    }
+  }
+
+  int err = device_flush(&cfg);
   if (err != LFS_ERR_OK) {
     return FS_Status_Err;
   }
-  return FS_Status_Ok;
+
+  err = lfs_unmount(&lfs);
+  if (err != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+  return status;
 }
 
 FS_Status_t FS_create_folder(const char *path) {
@@ -79,18 +275,26 @@ FS_Status_t FS_create_folder(const char *path) {
     return FS_Status_Err;
   }
 
+  /* The staging directory of transactions is reserved */
+  size_t reserved = sizeof(FS_TXN_DIR) - 1U;
+  if (strncmp(path, FS_TXN_DIR, reserved) == 0 &&
+      (path[reserved] == '\0' || path[reserved] == '/')) {
+    return FS_Status_Err;
+  }
+
   if (path[0] == '/' && path[1] == '\0') {
     return FS_Status_Folder_Already_Exists;
   }
+  if (path_cache_find(path, strlen(path)) != NULL) {
+    stats.path_cache_hits++;
+    return FS_Status_Folder_Already_Exists;
+  }
 
-  struct lfs_info file_info;
-  int ret = lfs_stat(&lfs, path, &file_info);
+  lfs_block_t pair[2];
+  int ret = lfs_dir_pair(&lfs, path, pair);
   if (ret == LFS_ERR_OK) {
-    if (file_info.type == LFS_TYPE_DIR) {
-      return FS_Status_Folder_Already_Exists;
-    } else {
-      return FS_Status_Err;
-    }
+    path_cache_insert(path, pair);
+    return FS_Status_Folder_Already_Exists;
   } else if (ret != LFS_ERR_NOENT) {
     return FS_Status_Err;
   }
@@ -174,6 +378,9 @@ FS_Status_t FS_create_folder(const char *path) {
     }
   }
 
+  if (lfs_dir_pair(&lfs, path, pair) == LFS_ERR_OK) {
+    path_cache_insert(path, pair);
+  }
   return FS_Status_Ok;
 }
 
@@ -183,38 +390,23 @@ FS_Status_t FS_save_to_file(const char *directory_path, const char *file_name,
     return FS_Status_Err;
   }
 
-  struct lfs_info dir_info;
-  int ret = lfs_stat(&lfs, directory_path, &dir_info);
-  if (ret != LFS_ERR_OK || dir_info.type != LFS_TYPE_DIR) {
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  if (!directory_exists(directory_path)) {
     return FS_Status_Folder_Does_Not_Exist;
   }
 
   char full_path[LFS_NAME_MAX + 1];
-  size_t dir_len = strlen(directory_path);
-  size_t file_len = strlen(file_name);
-  size_t i, j;
-
-  if (dir_len + file_len + 2 > LFS_NAME_MAX) {
+  if (!build_full_path(directory_path, file_name, full_path)) {
     return FS_Status_Err;
   }
 
-  for (i = 0; i < dir_len && i < LFS_NAME_MAX; i++) {
-    full_path[i] = directory_path[i];
-  }
-
-  if (dir_len > 0 && directory_path[dir_len - 1] != '/') {
-    full_path[i++] = '/';
-  }
-
-  for (j = 0; j < file_len && i + j < LFS_NAME_MAX; j++) {
-    full_path[i + j] = file_name[j];
-  }
-
-  full_path[i + j] = '\0';
-
   int flags = LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC;
 
-  ret = lfs_file_open(&lfs, &file, full_path, flags);
+  int ret = lfs_file_open(&lfs, &file, full_path, flags);
   if (ret != LFS_ERR_OK) {
     return FS_Status_Err;
   }
@@ -230,43 +422,93 @@ FS_Status_t FS_save_to_file(const char *directory_path, const char *file_name,
   return FS_Status_Ok;
 }
 
-FS_Status_t FS_get_file_size(const char *directory_path, const char *file_name,
-                             size_t *output_size) {
-  if (directory_path == NULL || file_name == NULL || output_size == NULL) {
+FS_Status_t FS_append_to_file(const char *directory_path, const char *file_name,
+                              const uint8_t *data, const size_t data_size) {
+  if (directory_path == NULL || file_name == NULL || data == NULL) {
     return FS_Status_Err;
   }
 
-  struct lfs_info dir_info;
-  int ret = lfs_stat(&lfs, directory_path, &dir_info);
-  if (ret != LFS_ERR_OK || dir_info.type != LFS_TYPE_DIR) {
-    return FS_Status_Folder_Does_Not_Exist;
+  char full_path[LFS_NAME_MAX + 1];
+  if (!build_full_path(directory_path, file_name, full_path)) {
+    return FS_Status_Err;
   }
 
-  char full_path[LFS_NAME_MAX + 1];
-  size_t dir_len = strlen(directory_path);
-  size_t file_len = strlen(file_name);
-  size_t i, j;
+  if (append_used > 0 && (strcmp(append_path, full_path) != 0 ||
+                          append_used + data_size > append_threshold)) {
+    FS_Status_t status = FS_flush_appends();
+    if (status != FS_Status_Ok) {
+      return status;
+    }
+  }
 
-  if (dir_len + file_len + 2 > LFS_NAME_MAX) {
+  if (append_used == 0) {
+    if (!directory_exists(directory_path)) {
+      return FS_Status_Folder_Does_Not_Exist;
+    }
+  }
+
+  if (data_size > append_threshold) {
+    return append_write(full_path, data, data_size);
+  }
+
+  if (append_used == 0) {
+    memcpy(append_path, full_path, sizeof(append_path));
+  }
+  memcpy(&append_buffer[append_used], data, data_size);
+  append_used += data_size;
+
+  if (append_used == append_threshold) {
+    return FS_flush_appends();
+  }
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_flush_appends(void) {
+  if (append_used == 0) {
+    return FS_Status_Ok;
+  }
+
+  /* The collected data is dropped on failure, so that one bad write does not
+   * make every later file operation fail. */
+  size_t size = append_used;
+  append_used = 0;
+  return append_write(append_path, append_buffer, size);
+}
+
+FS_Status_t FS_set_append_threshold(size_t threshold) {
+  if (threshold > FS_APPEND_BUFFER_SIZE) {
     return FS_Status_Err;
   }
 
-  for (i = 0; i < dir_len && i < LFS_NAME_MAX; i++) {
-    full_path[i] = directory_path[i];
+  FS_Status_t status = FS_flush_appends();
+  append_threshold = threshold;
+
+  return status;
+}
+
+FS_Status_t FS_get_file_size(const char *directory_path, const char *file_name,
+                             size_t *output_size) {
+  if (directory_path == NULL || file_name == NULL || output_size == NULL) {
+    return FS_Status_Err;
   }
 
-  if (dir_len > 0 && directory_path[dir_len - 1] != '/') {
-    full_path[i++] = '/';
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
   }
 
-  for (j = 0; j < file_len && i + j < LFS_NAME_MAX; j++) {
-    full_path[i + j] = file_name[j];
+  if (!directory_exists(directory_path)) {
+    return FS_Status_Folder_Does_Not_Exist;
   }
 
-  full_path[i + j] = '\0';
+  char full_path[LFS_NAME_MAX + 1];
+  if (!build_full_path(directory_path, file_name, full_path)) {
+    return FS_Status_Err;
+  }
 
   struct lfs_info file_info;
-  ret = lfs_stat(&lfs, full_path, &file_info);
+  int ret = lfs_stat(&lfs, full_path, &file_info);
   if (ret != LFS_ERR_OK) {
     return FS_Status_File_Does_Not_Exist;
   }
@@ -286,90 +528,1261 @@ FS_Status_t FS_read_from_file(const char *directory_path, const char *file_name,
     return FS_Status_Err;
   }
 
-  struct lfs_info dir_info;
-  int ret = lfs_stat(&lfs, directory_path, &dir_info);
-  if (ret != LFS_ERR_OK || dir_info.type != LFS_TYPE_DIR) {
-    return FS_Status_Folder_Does_Not_Exist;
+  FS_Status_t status = open_file(directory_path, file_name, LFS_O_RDONLY);
+  if (status != FS_Status_Ok) {
+    return status;
   }
 
-  char full_path[LFS_NAME_MAX + 1];
-  size_t dir_len = strlen(directory_path);
-  size_t file_len = strlen(file_name);
-  size_t i, j;
+  lfs_soff_t size = lfs_file_size(&lfs, &file);
+  lfs_ssize_t bytes_read = -1;
+  if (size >= 0) {
+    bytes_read = lfs_file_read(&lfs, &file, output_data, (lfs_size_t)size);
+  }
 
-  if (dir_len + file_len + 2 > LFS_NAME_MAX) {
+  int close_ret = lfs_file_close(&lfs, &file);
+
+  if (size < 0 || bytes_read != size || close_ret != LFS_ERR_OK) {
     return FS_Status_Err;
   }
 
-  for (i = 0; i < dir_len && i < LFS_NAME_MAX; i++) {
-    full_path[i] = directory_path[i];
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_read_range(const char *directory_path, const char *file_name,
+                          size_t offset, size_t length, uint8_t *output_data,
+                          size_t *output_read) {
+  if (directory_path == NULL || file_name == NULL || output_data == NULL ||
+      output_read == NULL) {
+    return FS_Status_Err;
   }
 
-  if (dir_len > 0 && directory_path[dir_len - 1] != '/') {
-    full_path[i++] = '/';
+  FS_Status_t status = open_file(directory_path, file_name, LFS_O_RDONLY);
+  if (status != FS_Status_Ok) {
+    return status;
   }
 
-  for (j = 0; j < file_len && i + j < LFS_NAME_MAX; j++) {
-    full_path[i + j] = file_name[j];
+  /* The seek only updates the position: lfs walks the skip-list of the file
+   * to the block holding the offset on the first read. The length is clamped
+   * to the end of the file first, so a size_t length wider than lfs_size_t
+   * is not truncated. */
+  lfs_soff_t size = lfs_file_size(&lfs, &file);
+  lfs_ssize_t bytes_read = -1;
+  if (size >= 0 && offset <= (size_t)size &&
+      lfs_file_seek(&lfs, &file, (lfs_soff_t)offset, LFS_SEEK_SET) ==
+          (lfs_soff_t)offset) {
+    size_t remaining = (size_t)size - offset;
+    if (length > remaining) {
+      length = remaining;
+    }
+    bytes_read = lfs_file_read(&lfs, &file, output_data, (lfs_size_t)length);
   }
 
-  full_path[i + j] = '\0';
+  int close_ret = lfs_file_close(&lfs, &file);
 
-  /* Check if file exists and get its size */
-  struct lfs_info file_info;
-  ret = lfs_stat(&lfs, full_path, &file_info);
-  if (ret != LFS_ERR_OK) {
-    return FS_Status_File_Does_Not_Exist;
+  if (bytes_read < 0 || close_ret != LFS_ERR_OK) {
+    return FS_Status_Err;
   }
 
-  if (file_info.type != LFS_TYPE_REG) {
+  *output_read = (size_t)bytes_read;
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_list_dir(const char *directory_path,
+                        FS_Dir_Entry_t *output_entries, size_t max_entries,
+                        FS_Dir_Cursor_t *cursor, size_t *output_count) {
+  if (directory_path == NULL || output_entries == NULL || cursor == NULL ||
+      output_count == NULL) {
     return FS_Status_Err;
   }
 
-  /* Open the file for reading */
-  ret = lfs_file_open(&lfs, &file, full_path, LFS_O_RDONLY);
-  if (ret != LFS_ERR_OK) {
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  *output_count = 0;
+  if (cursor->end) {
+    return FS_Status_Ok;
+  }
+
+  lfs_dir_t dir;
+  int ret = lfs_dir_open(&lfs, &dir, directory_path);
+  if (ret == LFS_ERR_NOENT || ret == LFS_ERR_NOTDIR) {
+    return FS_Status_Folder_Does_Not_Exist;
+  } else if (ret != LFS_ERR_OK) {
     return FS_Status_Err;
   }
 
-  /* Read the file content */
-  lfs_ssize_t bytes_read =
-      lfs_file_read(&lfs, &file, output_data, file_info.size);
+  if (cursor->position > 0U) {
+    ret = lfs_dir_seek(&lfs, &dir, cursor->position);
+  }
+
+  /* The staging directory of transactions is not listed */
+  bool root = directory_path[strspn(directory_path, "/")] == '\0';
+
+  size_t count = 0;
+  while (ret == LFS_ERR_OK && count < max_entries) {
+    struct lfs_info info;
+    ret = lfs_dir_read(&lfs, &dir, &info);
+    if (ret == 0) {
+      cursor->end = true;
+      break;
+    } else if (ret < 0) {
+      break;
+    }
+    ret = LFS_ERR_OK;
+
+    if (strcmp(info.name, ".") == 0 || strcmp(info.name, "..") == 0 ||
+        (root && strcmp(info.name, &FS_TXN_DIR[1]) == 0)) {
+      continue;
+    }
+
+    FS_Dir_Entry_t *entry = &output_entries[count];
+    memcpy(entry->name, info.name, sizeof(entry->name));
+    entry->type = (info.type == LFS_TYPE_DIR) ? FS_Entry_Folder : FS_Entry_File;
+    entry->size = (info.type == LFS_TYPE_DIR) ? 0U : info.size;
+    count++;
+  }
+
+  lfs_soff_t position = lfs_dir_tell(&lfs, &dir);
+  int close_ret = lfs_dir_close(&lfs, &dir);
+
+  if (ret < 0 || position < 0 || close_ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  cursor->position = (uint32_t)position;
+  *output_count = count;
+
+  return FS_Status_Ok;
+}
 
-  /* Close the file */
+FS_Status_t FS_map_file(const char *directory_path, const char *file_name,
+                        size_t offset, const uint8_t **output_data,
+                        size_t *output_size) {
+  if (directory_path == NULL || file_name == NULL || output_data == NULL ||
+      output_size == NULL) {
+    return FS_Status_Err;
+  }
+
+  FS_Status_t status = open_file(directory_path, file_name, LFS_O_RDONLY);
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  lfs_soff_t file_size = lfs_file_size(&lfs, &file);
+  if (file_size < 0 || offset >= (size_t)file_size) {
+    lfs_file_close(&lfs, &file);
+    return FS_Status_Err;
+  }
+
+  /* The data is contiguous on flash up to the end of the block holding the
+   * offset or of the file. Data of inline files lives inside metadata entries
+   * and cannot be mapped. */
+  lfs_block_t block;
+  lfs_off_t block_off;
+  lfs_size_t size;
+  int ret = lfs_file_extent(&lfs, &file, (lfs_off_t)offset, &block,
+                            &block_off, &size);
   int close_ret = lfs_file_close(&lfs, &file);
+  if (ret == LFS_ERR_INVAL) {
+    return FS_Status_Not_Supported;
+  }
+  if (ret != LFS_ERR_OK || close_ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+  uint32_t address = block * cfg.block_size + block_off;
+
+  const void *mapped = MEMIO_map(address, size);
+  if (mapped == NULL) {
+    return FS_Status_Not_Supported;
+  }
+
+  *output_data = mapped;
+  *output_size = size;
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_open(const char *directory_path, const char *file_name,
+                    int flags, FS_File_t **output_file) {
+  if (directory_path == NULL || file_name == NULL || output_file == NULL ||
+      (flags & (FS_Open_Read | FS_Open_Write)) == 0) {
+    return FS_Status_Err;
+  }
+
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  FS_File_t *handle = NULL;
+  for (size_t i = 0; i < FS_FILES_MAX && handle == NULL; i++) {
+    if (!files[i].in_use) {
+      handle = &files[i];
+    }
+  }
+  if (handle == NULL) {
+    return FS_Status_Too_Many_Open_Files;
+  }
+
+  if (!directory_exists(directory_path)) {
+    return FS_Status_Folder_Does_Not_Exist;
+  }
+
+  char full_path[LFS_NAME_MAX + 1];
+  if (!build_full_path(directory_path, file_name, full_path)) {
+    return FS_Status_Err;
+  }
+
+  int lfs_flags = 0;
+  if ((flags & FS_Open_Read) != 0) {
+    lfs_flags |= LFS_O_RDONLY;
+  }
+  if ((flags & FS_Open_Write) != 0) {
+    lfs_flags |= LFS_O_WRONLY;
+  }
+  if ((flags & FS_Open_Create) != 0) {
+    lfs_flags |= LFS_O_CREAT;
+  }
+  if ((flags & FS_Open_Truncate) != 0) {
+    lfs_flags |= LFS_O_TRUNC;
+  }
+  if ((flags & FS_Open_Append) != 0) {
+    lfs_flags |= LFS_O_APPEND;
+  }
 
-  if (bytes_read != (lfs_ssize_t)file_info.size || close_ret != LFS_ERR_OK) {
+  memset(&handle->config, 0, sizeof(handle->config));
+  handle->config.buffer = handle->cache;
+  int ret = lfs_file_opencfg(&lfs, &handle->file, full_path, lfs_flags,
+                             &handle->config);
+  if (ret == LFS_ERR_NOENT) {
+    return FS_Status_File_Does_Not_Exist;
+  } else if (ret != LFS_ERR_OK) {
     return FS_Status_Err;
   }
 
+  handle->in_use = true;
+  *output_file = handle;
+
   return FS_Status_Ok;
 }
 
-static int read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
-                void *buffer, lfs_size_t size) {
-  MEMIO_Status_t status = MEMIO_read(block * c->block_size + off, buffer, size);
-  if (status != MEMIO_Status_Ok) {
-    return LFS_ERR_IO;
+FS_Status_t FS_read(FS_File_t *file, uint8_t *output_data, size_t size,
+                    size_t *output_read) {
+  if (!file_is_open(file) || output_data == NULL || output_read == NULL) {
+    return FS_Status_Err;
   }
-  return LFS_ERR_OK;
+
+  lfs_ssize_t bytes_read =
+      lfs_file_read(&lfs, &file->file, output_data, (lfs_size_t)size);
+  if (bytes_read < 0) {
+    return FS_Status_Err;
+  }
+
+  *output_read = (size_t)bytes_read;
+
+  return FS_Status_Ok;
 }
 
-static int prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
-                const void *buffer, lfs_size_t size) {
-  MEMIO_Status_t status = MEMIO_prog(block * c->block_size + off, buffer, size);
-  if (status != MEMIO_Status_Ok) {
-    return LFS_ERR_IO;
+FS_Status_t FS_write(FS_File_t *file, const uint8_t *data, size_t size) {
+  if (!file_is_open(file) || data == NULL) {
+    return FS_Status_Err;
   }
-  return LFS_ERR_OK;
+
+  lfs_ssize_t bytes_written =
+      lfs_file_write(&lfs, &file->file, data, (lfs_size_t)size);
+  if (bytes_written != (lfs_ssize_t)size) {
+    return FS_Status_Err;
+  }
+
+  return FS_Status_Ok;
 }
 
-static int erase(const struct lfs_config *c, lfs_block_t block) {
-  MEMIO_Status_t status = MEMIO_erase(block * c->block_size);
-  if (status != MEMIO_Status_Ok) {
-    return LFS_ERR_IO;
+FS_Status_t FS_seek(FS_File_t *file, int32_t offset, FS_Seek_Origin_t origin,
+                    size_t *output_position) {
+  if (!file_is_open(file)) {
+    return FS_Status_Err;
   }
-  return LFS_ERR_OK;
+
+  int whence;
+  switch (origin) {
+  case FS_Seek_Set:
+    whence = LFS_SEEK_SET;
+    break;
+  case FS_Seek_Cur:
+    whence = LFS_SEEK_CUR;
+    break;
+  case FS_Seek_End:
+    whence = LFS_SEEK_END;
+    break;
+  default:
+    return FS_Status_Err;
+  }
+
+  lfs_soff_t position = lfs_file_seek(&lfs, &file->file, offset, whence);
+  if (position < 0) {
+    return FS_Status_Err;
+  }
+
+  if (output_position != NULL) {
+    *output_position = (size_t)position;
+  }
+
+  return FS_Status_Ok;
 }
 
-static int sync(const struct lfs_config *c) { return LFS_ERR_OK; }
\ No newline at end of file
+FS_Status_t FS_sync(FS_File_t *file) {
+  if (!file_is_open(file)) {
+    return FS_Status_Err;
+  }
+
+  int ret = lfs_file_sync(&lfs, &file->file);
+  if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_close(FS_File_t *file) {
+  if (!file_is_open(file)) {
+    return FS_Status_Err;
+  }
+
+  int ret = lfs_file_close(&lfs, &file->file);
+  file->in_use = false;
+  if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_txn_begin(void) {
+  if (txn_active) {
+    return FS_Status_Err;
+  }
+
+  txn_active = true;
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_txn_write(const char *directory_path, const char *file_name,
+                         const uint8_t *data, size_t size) {
+  if (!txn_active || directory_path == NULL || file_name == NULL ||
+      data == NULL) {
+    return FS_Status_Err;
+  }
+
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  char path[LFS_NAME_MAX + 1];
+  if (!build_full_path(directory_path, file_name, path)) {
+    return FS_Status_Err;
+  }
+
+  /* Staging a file again replaces what was staged before */
+  FS_File_t *handle = NULL;
+  size_t slot = 0;
+  for (size_t i = 0; i < FS_TXN_FILES_MAX; i++) {
+    if (txn_files[i].in_use && strcmp(txn_paths[i], path) == 0) {
+      file_discard(&txn_files[i]);
+      handle = &txn_files[i];
+      slot = i;
+      break;
+    }
+    if (!txn_files[i].in_use && handle == NULL) {
+      handle = &txn_files[i];
+      slot = i;
+    }
+  }
+  if (handle == NULL) {
+    return FS_Status_Too_Many_Open_Files;
+  }
+
+  /* Written but not synced: the old contents stay on storage. The file is
+   * also readable, for a transaction that has to copy it. */
+  memset(&handle->config, 0, sizeof(handle->config));
+  handle->config.buffer = handle->cache;
+  int ret = lfs_file_opencfg(&lfs, &handle->file, path,
+                             LFS_O_RDWR | LFS_O_CREAT | LFS_O_TRUNC,
+                             &handle->config);
+  if (ret != LFS_ERR_OK) {
+    return directory_exists(directory_path) ? FS_Status_Err
+                                            : FS_Status_Folder_Does_Not_Exist;
+  }
+  handle->in_use = true;
+
+  lfs_ssize_t bytes_written =
+      lfs_file_write(&lfs, &handle->file, data, (lfs_size_t)size);
+  if (bytes_written != (lfs_ssize_t)size) {
+    file_discard(handle);
+    return FS_Status_Err;
+  }
+
+  memcpy(txn_paths[slot], path, sizeof(path));
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_txn_commit(void) {
+  if (!txn_active) {
+    return FS_Status_Err;
+  }
+
+  lfs_file_t *staged[FS_TXN_FILES_MAX];
+  lfs_size_t count = 0;
+  for (size_t i = 0; i < FS_TXN_FILES_MAX; i++) {
+    if (txn_files[i].in_use) {
+      staged[count++] = &txn_files[i].file;
+    }
+  }
+  txn_active = false;
+
+  /* One commit publishes every file when they share a metadata pair. When
+   * they do not, lfs_file_syncv() commits nothing and the journal is used. */
+  int ret = lfs_file_syncv(&lfs, staged, count);
+  if (ret == LFS_ERR_INVAL) {
+    return txn_commit_journal();
+  }
+
+  /* The files are clean now, so closing them commits nothing more */
+  FS_Status_t status = (ret == LFS_ERR_OK) ? FS_Status_Ok : FS_Status_Err;
+  for (size_t i = 0; i < FS_TXN_FILES_MAX; i++) {
+    if (!txn_files[i].in_use) {
+      continue;
+    }
+    if (ret != LFS_ERR_OK) {
+      file_discard(&txn_files[i]);
+    } else if (lfs_file_close(&lfs, &txn_files[i].file) != LFS_ERR_OK) {
+      status = FS_Status_Err;
+    }
+    txn_files[i].in_use = false;
+  }
+
+  return status;
+}
+
+FS_Status_t FS_txn_abort(void) {
+  if (!txn_active) {
+    return FS_Status_Err;
+  }
+
+  for (size_t i = 0; i < FS_TXN_FILES_MAX; i++) {
+    if (txn_files[i].in_use) {
+      file_discard(&txn_files[i]);
+    }
+  }
+  txn_active = false;
+
+  return FS_Status_Ok;
+}
+
+/* Opens the file with a single path lookup. The directory is only looked up
+ * when that fails, to tell which part of the path is missing. */
+static FS_Status_t open_file(const char *directory_path, const char *file_name,
+                             int flags) {
+  FS_Status_t status = FS_flush_appends();
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+
+  char full_path[LFS_NAME_MAX + 1];
+  if (!build_full_path(directory_path, file_name, full_path)) {
+    return FS_Status_Err;
+  }
+
+  int ret = lfs_file_open(&lfs, &file, full_path, flags);
+  if (ret == LFS_ERR_OK) {
+    return FS_Status_Ok;
+  } else if (ret != LFS_ERR_NOENT && ret != LFS_ERR_NOTDIR) {
+    return FS_Status_Err;
+  }
+
+  if (!directory_exists(directory_path)) {
+    return FS_Status_Folder_Does_Not_Exist;
+  }
+  return FS_Status_File_Does_Not_Exist;
+}
+
+static FS_Status_t append_write(const char *full_path, const uint8_t *data,
+                                size_t size) {
+  int ret = lfs_file_open(&lfs, &file, full_path,
+                          LFS_O_WRONLY | LFS_O_CREAT | LFS_O_APPEND);
+  if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  lfs_ssize_t bytes_written = lfs_file_write(&lfs, &file, data, size);
+
+  int close_ret = lfs_file_close(&lfs, &file);
+
+  if (bytes_written != (lfs_ssize_t)size || close_ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  return FS_Status_Ok;
+}
+
+/* Copies the staged files to temporary files, then publishes them through the
+ * journal. The staged files themselves are never committed. When the journal
+ * was written but the renames failed, the staging directory is left for
+ * FS_init() to finish. */
+static FS_Status_t txn_commit_journal(void) {
+  int ret = lfs_mkdir(&lfs, FS_TXN_DIR);
+  bool copied = (ret == LFS_ERR_OK || ret == LFS_ERR_EXIST);
+
+  char temp_path[sizeof(FS_TXN_DIR "/0")];
+  size_t count = 0;
+  for (size_t i = 0; i < FS_TXN_FILES_MAX; i++) {
+    if (!txn_files[i].in_use) {
+      continue;
+    }
+    if (copied) {
+      txn_temp_path(count, temp_path);
+      copied = txn_copy(&txn_files[i].file, temp_path);
+      memmove(txn_paths[count], txn_paths[i], sizeof(txn_paths[i]));
+      count++;
+    }
+    file_discard(&txn_files[i]);
+  }
+
+  /* The journal is the single commit that publishes every file. Once it is
+   * on storage the transaction is done, even if the renames are cut short. */
+  FS_Status_t status = copied ? txn_journal_write(count) : FS_Status_Err;
+  if (status != FS_Status_Ok) {
+    txn_remove_staging();
+    return status;
+  }
+
+  status = txn_apply(count);
+  if (status != FS_Status_Ok) {
+    return status;
+  }
+  return txn_remove_staging();
+}
+
+/* Temporary files are named after their position in the journal. */
+static void txn_temp_path(size_t index, char *temp_path) {
+  memcpy(temp_path, FS_TXN_DIR "/0", sizeof(FS_TXN_DIR "/0"));
+  temp_path[sizeof(FS_TXN_DIR)] = (char)('0' + index);
+}
+
+static bool txn_copy(lfs_file_t *source, const char *temp_path) {
+  if (lfs_file_rewind(&lfs, source) != LFS_ERR_OK) {
+    return false;
+  }
+
+  int ret = lfs_file_open(&lfs, &file, temp_path,
+                          LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+  if (ret != LFS_ERR_OK) {
+    return false;
+  }
+
+  uint8_t chunk[FS_TXN_COPY_SIZE];
+  lfs_ssize_t bytes_read;
+  bool written = true;
+  do {
+    bytes_read = lfs_file_read(&lfs, source, chunk, sizeof(chunk));
+    written = bytes_read >= 0 &&
+              lfs_file_write(&lfs, &file, chunk, (lfs_size_t)bytes_read) ==
+                  bytes_read;
+  } while (written && bytes_read > 0);
+
+  /* lfs does not commit a file whose write failed */
+  ret = lfs_file_close(&lfs, &file);
+  return written && ret == LFS_ERR_OK;
+}
+
+/* The journal holds the magic, the number of files and the length and path
+ * of each target. lfs commits a file atomically when it is closed, so the
+ * journal is either empty or complete. */
+static FS_Status_t txn_journal_write(size_t count) {
+  int ret = lfs_file_open(&lfs, &file, FS_TXN_JOURNAL_PATH,
+                          LFS_O_WRONLY | LFS_O_CREAT | LFS_O_TRUNC);
+  if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  uint32_t header[2] = {FS_TXN_MAGIC, (uint32_t)count};
+  bool written = lfs_file_write(&lfs, &file, header, sizeof(header)) ==
+                 (lfs_ssize_t)sizeof(header);
+  for (size_t i = 0; i < count && written; i++) {
+    uint16_t length = (uint16_t)strlen(txn_paths[i]);
+    written = lfs_file_write(&lfs, &file, &length, sizeof(length)) ==
+                  (lfs_ssize_t)sizeof(length) &&
+              lfs_file_write(&lfs, &file, txn_paths[i], length) ==
+                  (lfs_ssize_t)length;
+  }
+
+  ret = lfs_file_close(&lfs, &file);
+  if (!written || ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+  return FS_Status_Ok;
+}
+
+/* Renames every temporary file over its target, then drops the journal. A
+ * missing temporary file was renamed before a power loss. */
+static FS_Status_t txn_apply(size_t count) {
+  char temp_path[sizeof(FS_TXN_DIR "/0")];
+  for (size_t i = 0; i < count; i++) {
+    txn_temp_path(i, temp_path);
+    int ret = lfs_rename(&lfs, temp_path, txn_paths[i]);
+    if (ret != LFS_ERR_OK && ret != LFS_ERR_NOENT) {
+      return FS_Status_Err;
+    }
+  }
+
+  int ret = lfs_remove(&lfs, FS_TXN_JOURNAL_PATH);
+  if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+  return FS_Status_Ok;
+}
+
+/* Removes the staging directory along with anything left in it. lfs is then
+ * free to reuse its metadata pair, which the path cache may still hold, so
+ * the cache is emptied. */
+static FS_Status_t txn_remove_staging(void) {
+  lfs_dir_t dir;
+  struct lfs_info info;
+  char entry_path[LFS_NAME_MAX + 1];
+
+  int ret = lfs_stat(&lfs, FS_TXN_DIR, &info);
+  if (ret == LFS_ERR_NOENT) {
+    return FS_Status_Ok;
+  }
+
+  /* A rename cut short by a power loss is only finished by the next write,
+   * and until then its source hides in the directory and keeps it from being
+   * removed. */
+  if (ret != LFS_ERR_OK || lfs_fs_mkconsistent(&lfs) != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  do {
+    ret = lfs_dir_open(&lfs, &dir, FS_TXN_DIR);
+    if (ret != LFS_ERR_OK) {
+      return FS_Status_Err;
+    }
+    do {
+      ret = lfs_dir_read(&lfs, &dir, &info);
+    } while (ret > 0 &&
+             (strcmp(info.name, ".") == 0 || strcmp(info.name, "..") == 0));
+    lfs_dir_close(&lfs, &dir);
+
+    if (ret > 0) {
+      if (!build_full_path(FS_TXN_DIR, info.name, entry_path) ||
+          lfs_remove(&lfs, entry_path) != LFS_ERR_OK) {
+        return FS_Status_Err;
+      }
+    }
+  } while (ret > 0);
+
+  path_cache_invalidate();
+  if (ret < 0 || lfs_remove(&lfs, FS_TXN_DIR) != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+  return FS_Status_Ok;
+}
+
+/* Finishes a transaction committed before a power loss. An empty or invalid
+ * journal belongs to a transaction that was not committed, and neither do
+ * temporary files without a journal: they are dropped and the targets keep
+ * their old contents. */
+static FS_Status_t txn_recover(void) {
+  int ret = lfs_file_open(&lfs, &file, FS_TXN_JOURNAL_PATH, LFS_O_RDONLY);
+  if (ret == LFS_ERR_NOENT || ret == LFS_ERR_NOTDIR) {
+    return txn_remove_staging();
+  } else if (ret != LFS_ERR_OK) {
+    return FS_Status_Err;
+  }
+
+  uint32_t header[2] = {0, 0};
+  bool valid = lfs_file_read(&lfs, &file, header, sizeof(header)) ==
+                   (lfs_ssize_t)sizeof(header) &&
+               header[0] == FS_TXN_MAGIC && header[1] <= FS_TXN_FILES_MAX;
+  size_t count = 0;
+  while (valid && count < header[1]) {
+    uint16_t length = 0;
+    valid = lfs_file_read(&lfs, &file, &length, sizeof(length)) ==
+                (lfs_ssize_t)sizeof(length) &&
+            length <= LFS_NAME_MAX &&
+            lfs_file_read(&lfs, &file, txn_paths[count], length) ==
+                (lfs_ssize_t)length;
+    if (valid) {
+      txn_paths[count][length] = '\0';
+      count++;
+    }
+  }
+  ret = lfs_file_close(&lfs, &file);
+
+  if (valid && ret == LFS_ERR_OK && txn_apply(count) != FS_Status_Ok) {
+    return FS_Status_Err;
+  }
+  return txn_remove_staging();
+}
+
+/* Only positive results are cached: the only directory the API removes is
+ * the staging directory of transactions, which empties the cache, so a
+ * directory that was found keeps existing until the file system is mounted
+ * again. */
+static bool directory_exists(const char *path) {
+  if (path_cache_find(path, strlen(path)) != NULL) {
+    stats.path_cache_hits++;
+    return true;
+  }
+
+  stats.path_cache_misses++;
+  lfs_block_t pair[2];
+  int ret = lfs_dir_pair(&lfs, path, pair);
+  if (ret != LFS_ERR_OK) {
+    return false;
+  }
+
+  path_cache_insert(path, pair);
+  return true;
+}
+
+/* Trailing slashes are ignored, so that "/a/" and "/a" share an entry. */
+static FS_Path_Cache_Entry_t *path_cache_find(const char *path, size_t length) {
+  while (length > 1U && path[length - 1U] == '/') {
+    length--;
+  }
+
+  for (size_t i = 0; i < FS_PATH_CACHE_ENTRIES; i++) {
+    FS_Path_Cache_Entry_t *entry = &path_cache[i];
+    if (entry->last_used != 0U && strncmp(entry->path, path, length) == 0 &&
+        entry->path[length] == '\0') {
+      entry->last_used = ++path_cache_clock;
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+/* Replaces the least recently used entry. */
+static void path_cache_insert(const char *path, const lfs_block_t pair[2]) {
+  size_t length = strlen(path);
+  while (length > 1U && path[length - 1U] == '/') {
+    length--;
+  }
+  if (length > FS_PATH_CACHE_PATH_MAX) {
+    return;
+  }
+
+  FS_Path_Cache_Entry_t *victim = &path_cache[0];
+  for (size_t i = 1; i < FS_PATH_CACHE_ENTRIES; i++) {
+    if (path_cache[i].last_used < victim->last_used) {
+      victim = &path_cache[i];
+    }
+  }
+  memcpy(victim->path, path, length);
+  victim->path[length] = '\0';
+  victim->pair[0] = pair[0];
+  victim->pair[1] = pair[1];
+  victim->last_used = ++path_cache_clock;
+}
+
+/* Called on mount, when the cache starts empty, and when a directory is
+ * removed. */
+static void path_cache_invalidate(void) {
+  memset(path_cache, 0, sizeof(path_cache));
+  path_cache_clock = 0;
+}
+
+/* Tells whether a handle is an open handle of the pool, rejecting NULL and
+ * pointers from anywhere else. */
+static bool file_is_open(const FS_File_t *file) {
+  return file != NULL && file >= &files[0] && file < &files[FS_FILES_MAX] &&
+         file->in_use;
+}
+
+/* Closes a file without committing what was written to it. lfs skips the sync
+ * of a file that errored, so it is marked as such. */
+static void file_discard(FS_File_t *file) {
+  file->file.flags |= LFS_F_ERRED;
+  lfs_file_close(&lfs, &file->file);
+  file->in_use = false;
+}
+
+static bool build_full_path(const char *directory_path, const char *file_name,
+                            char *full_path) {
+  size_t dir_len = strlen(directory_path);
+  size_t file_len = strlen(file_name);
+  size_t i, j;
+
+  if (dir_len + file_len + 2 > LFS_NAME_MAX) {
+    return false;
+  }
+
+  for (i = 0; i < dir_len && i < LFS_NAME_MAX; i++) {
+    full_path[i] = directory_path[i];
+  }
+
+  if (dir_len > 0 && directory_path[dir_len - 1] != '/') {
+    full_path[i++] = '/';
+  }
+
+  for (j = 0; j < file_len && i + j < LFS_NAME_MAX; j++) {
+    full_path[i + j] = file_name[j];
+  }
+
+  full_path[i + j] = '\0';
+
+  return true;
+}
+
+FS_Status_t FS_get_stats(FS_Stats_t *output_stats) {
+  if (output_stats == NULL) {
+    return FS_Status_Err;
+  }
+
+  *output_stats = stats;
+
+  return FS_Status_Ok;
+}
+
+FS_Status_t FS_set_trace(FS_Trace_Callback_t callback, void *context) {
+  trace_callback = callback;
+  trace_context = context;
+
+  return FS_Status_Ok;
+}
+
+static int config_from_geometry(struct lfs_config *c) {
+  MEMIO_Geometry_t geometry;
+  MEMIO_Status_t status = MEMIO_get_geometry(&geometry);
+  if (status != MEMIO_Status_Ok || geometry.page_size == 0 ||
+      geometry.sector_size % geometry.page_size != 0 ||
+      geometry.size % geometry.sector_size != 0) {
+    return LFS_ERR_INVAL;
+  }
+
+  c->read_size = geometry.page_size;
+  c->prog_size = geometry.page_size;
+  c->block_size = geometry.sector_size;
+  c->block_count = geometry.size / geometry.sector_size;
+
+  /* Kept a power-of-two number of pages so it still divides the block size. */
+  lfs_size_t cache_size = geometry.page_size;
+  while (cache_size < FS_CACHE_SIZE_MAX && cache_size < c->block_size &&
+         (cache_size / geometry.page_size) * FS_CACHE_SCALE_SIZE <
+             geometry.size) {
+    cache_size *= 2U;
+  }
+  c->cache_size = cache_size;
+
+  /* Track every block in the lookahead bitmap when it fits, so the allocator
+   * rarely has to rescan the file system. */
+  lfs_size_t lookahead_size = ((c->block_count + 63U) / 64U) * 8U;
+  if (lookahead_size > FS_LOOKAHEAD_SIZE_MAX) {
+    lookahead_size = FS_LOOKAHEAD_SIZE_MAX;
+  }
+  c->lookahead_size = lookahead_size;
+
+  return LFS_ERR_OK;
+}
+
+static int read(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                void *buffer, lfs_size_t size) {
+  uint32_t address = block * c->block_size + off;
+
+  int err = read_device(c, address, buffer, size);
+  if (err == LFS_ERR_OK) {
+    trace(FS_Trace_Read, address, size, buffer);
+  }
+  return err;
+}
+
+static int read_device(const struct lfs_config *c, uint32_t address,
+                       void *buffer, lfs_size_t size) {
+  bool suspended = false;
+  int err = device_settle(c, address, size, &suspended);
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  MEMIO_Status_t status = MEMIO_read(address, buffer, size);
+  if (suspended) {
+    err = device_resume(status);
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+    if (status != MEMIO_Status_Ok) {
+      status = MEMIO_read(address, buffer, size);
+    }
+  }
+  if (status != MEMIO_Status_Ok) {
+    return LFS_ERR_IO;
+  }
+  return LFS_ERR_OK;
+}
+
+static int prog(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+                const void *buffer, lfs_size_t size) {
+  uint32_t address = block * c->block_size + off;
+  trace(FS_Trace_Prog, address, size, buffer);
+
+  int err = erase_queue_submit(c);
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  if (size > FS_PROG_BATCH_SIZE) {
+    err = device_flush(c);
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+
+    MEMIO_Status_t status = MEMIO_prog(address, buffer, size);
+    if (status != MEMIO_Status_Ok) {
+      return LFS_ERR_IO;
+    }
+    return LFS_ERR_OK;
+  }
+
+  if (prog_batch->count == FS_PROG_BATCH_EXTENTS ||
+      prog_batch->used + size > FS_PROG_BATCH_SIZE) {
+    err = prog_batch_submit();
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+  }
+
+  memcpy(&prog_batch->data[prog_batch->used], buffer, size);
+  MEMIO_Extent_t *extent = &prog_batch->extents[prog_batch->count];
+  extent->address = address;
+  extent->buffer = &prog_batch->data[prog_batch->used];
+  extent->size = size;
+  prog_batch->count++;
+  prog_batch->used += size;
+
+  /* Keep the device busy: start the batch as soon as the device is free, so
+   * it programs while lfs prepares the next page, e.g. computing its CRC. */
+  if (!MEMIO_is_busy()) {
+    return prog_batch_submit();
+  }
+  return LFS_ERR_OK;
+}
+
+static int erase(const struct lfs_config *c, lfs_block_t block) {
+  uint32_t address = block * c->block_size;
+  stats.erases_requested++;
+
+  /* Skip the erase when the block is already blank, e.g. right after a format
+   * or when lfs reuses a block it never wrote. The check is only done when the
+   * device is idle and nothing queued targets the block, so it never waits. */
+  if (!device_pending_overlaps(c, address, c->block_size) &&
+      !MEMIO_is_busy()) {
+    bool erased = false;
+    MEMIO_Status_t status = MEMIO_is_erased(address, c->block_size, &erased);
+    if (status == MEMIO_Status_Ok && erased) {
+      stats.erases_avoided++;
+      return LFS_ERR_OK;
+    }
+  }
+  trace(FS_Trace_Erase, address, c->block_size, NULL);
+
+  int err = prog_batch_submit();
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  if (erase_queue_count > 0 &&
+      block != erase_queue_start + erase_queue_count) {
+    err = erase_queue_submit(c);
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+  }
+
+  if (erase_queue_count == 0) {
+    erase_queue_start = block;
+  }
+  erase_queue_count++;
+
+  return LFS_ERR_OK;
+}
+
+static int sync(const struct lfs_config *c) {
+  trace(FS_Trace_Sync, 0, 0, NULL);
+  return device_flush(c);
+}
+
+static int crc(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+               lfs_size_t size, uint32_t *value) {
+  uint32_t address = block * c->block_size + off;
+
+  bool suspended = false;
+  uint32_t seed = *value;
+  int err = device_settle(c, address, size, &suspended);
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  MEMIO_Status_t status = MEMIO_crc32(address, size, value);
+  if (suspended) {
+    err = device_resume(status);
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+    if (status != MEMIO_Status_Ok) {
+      *value = seed;
+      status = MEMIO_crc32(address, size, value);
+    }
+  }
+  if (status != MEMIO_Status_Ok) {
+    return LFS_ERR_IO;
+  }
+  trace(FS_Trace_Read, address, size, NULL);
+  return LFS_ERR_OK;
+}
+
+static int cmp(const struct lfs_config *c, lfs_block_t block, lfs_off_t off,
+               const void *buffer, lfs_size_t size, int *res) {
+  uint32_t address = block * c->block_size + off;
+
+  bool suspended = false;
+  int err = device_settle(c, address, size, &suspended);
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  MEMIO_Status_t status = MEMIO_compare(address, buffer, size, res);
+  if (suspended) {
+    err = device_resume(status);
+    if (err != LFS_ERR_OK) {
+      return err;
+    }
+    if (status != MEMIO_Status_Ok) {
+      status = MEMIO_compare(address, buffer, size, res);
+    }
+  }
+  if (status != MEMIO_Status_Ok) {
+    return LFS_ERR_IO;
+  }
+  trace(FS_Trace_Read, address, size, NULL);
+  return LFS_ERR_OK;
+}
+
+/* Lets lfs start from the cached pair of the directory of a file, instead of
+ * walking the directory path from the root. */
+static bool dir_lookup(const struct lfs_config *c, const char *path,
+                       lfs_size_t *len, lfs_block_t pair[2]) {
+  (void)c;
+  const char *name = strrchr(path, '/');
+  if (name == NULL || name == path || strcmp(name, "/") == 0 ||
+      strcmp(name, "/.") == 0 || strcmp(name, "/..") == 0) {
+    return false;
+  }
+
+  size_t length = (size_t)(name - path);
+  const FS_Path_Cache_Entry_t *entry = path_cache_find(path, length);
+  if (entry == NULL) {
+    return false;
+  }
+
+  *len = (lfs_size_t)length;
+  pair[0] = entry->pair[0];
+  pair[1] = entry->pair[1];
+  return true;
+}
+
+/* Keeps the cached pairs of directories lfs moves to other blocks. A pair
+ * is matched like lfs_pair_cmp() does, as compaction swaps its blocks. */
+static void dir_relocate(const struct lfs_config *c,
+                         const lfs_block_t oldpair[2],
+                         const lfs_block_t newpair[2]) {
+  (void)c;
+  for (size_t i = 0; i < FS_PATH_CACHE_ENTRIES; i++) {
+    FS_Path_Cache_Entry_t *entry = &path_cache[i];
+    if (entry->last_used != 0U &&
+        (entry->pair[0] == oldpair[0] || entry->pair[0] == oldpair[1] ||
+         entry->pair[1] == oldpair[0] || entry->pair[1] == oldpair[1])) {
+      entry->pair[0] = newpair[0];
+      entry->pair[1] = newpair[1];
+    }
+  }
+}
+
+static void trace(FS_Trace_Op_t op, uint32_t address, uint32_t size,
+                  const void *data) {
+  if (trace_callback != NULL) {
+    trace_callback(op, address, size, data, trace_context);
+  }
+}
+
+static void device_done(MEMIO_Status_t status, void *context) {
+  FS_Prog_Batch_t *batch = context;
+  if (batch != NULL) {
+    batch->count = 0;
+    batch->used = 0;
+  }
+  if (status != MEMIO_Status_Ok) {
+    device_status = status;
+  }
+  device_in_flight = false;
+}
+
+static int device_wait(void) {
+  if (device_in_flight) {
+    MEMIO_wait();
+  }
+
+  MEMIO_Status_t status = device_status;
+  device_status = MEMIO_Status_Ok;
+  if (status != MEMIO_Status_Ok) {
+    return LFS_ERR_IO;
+  }
+  return LFS_ERR_OK;
+}
+
+/* Forget any work left over from a previous session, e.g. one cut short by a
+ * power loss, as the device does not remember it either. */
+static void device_reset(void) {
+  prog_batches[0].count = 0;
+  prog_batches[0].used = 0;
+  prog_batches[1].count = 0;
+  prog_batches[1].used = 0;
+  prog_batch = &prog_batches[0];
+  erase_queue_count = 0;
+  device_in_flight = false;
+  device_status = MEMIO_Status_Ok;
+}
+
+static int device_flush(const struct lfs_config *c) {
+  int err = prog_batch_submit();
+  if (err == LFS_ERR_OK) {
+    err = erase_queue_submit(c);
+  }
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+  return device_wait();
+}
+
+/* Make the region readable, finishing only the work that blocks it. Other
+ * work in progress is suspended rather than waited for when the device allows
+ * it, in which case the caller reads and then calls device_resume(). */
+static int device_settle(const struct lfs_config *c, uint32_t address,
+                         uint32_t size, bool *suspended) {
+  *suspended = false;
+  if (device_pending_overlaps(c, address, size)) {
+    return device_flush(c);
+  }
+  if (MEMIO_is_busy()) {
+    if (MEMIO_suspend() == MEMIO_Status_Ok) {
+      *suspended = true;
+      return LFS_ERR_OK;
+    }
+    MEMIO_wait();
+    return device_wait();
+  }
+  return LFS_ERR_OK;
+}
+
+/* Resume the work suspended by device_settle(). When the read failed while
+ * suspended, the work is finished so the caller can read again. */
+static int device_resume(MEMIO_Status_t status) {
+  MEMIO_resume();
+  if (status == MEMIO_Status_Ok) {
+    return LFS_ERR_OK;
+  }
+  MEMIO_wait();
+  return device_wait();
+}
+
+static bool device_pending_overlaps(const struct lfs_config *c,
+                                    uint32_t address, uint32_t size) {
+  uint32_t end = address + size;
+
+  if (device_in_flight && address < device_in_flight_end &&
+      device_in_flight_start < end) {
+    return true;
+  }
+
+  if (erase_queue_count > 0 &&
+      address < (erase_queue_start + erase_queue_count) * c->block_size &&
+      erase_queue_start * c->block_size < end) {
+    return true;
+  }
+
+  for (uint32_t i = 0; i < prog_batch->count; i++) {
+    const MEMIO_Extent_t *extent = &prog_batch->extents[i];
+    if (address < extent->address + extent->size && extent->address < end) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static int prog_batch_submit(void) {
+  if (prog_batch->count == 0) {
+    return LFS_ERR_OK;
+  }
+
+  int err = device_wait();
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  FS_Prog_Batch_t *batch = prog_batch;
+  prog_batch =
+      (batch == &prog_batches[0]) ? &prog_batches[1] : &prog_batches[0];
+
+  device_in_flight = true;
+  device_in_flight_start = batch->extents[0].address;
+  device_in_flight_end = batch->extents[0].address + batch->extents[0].size;
+  for (uint32_t i = 1; i < batch->count; i++) {
+    const MEMIO_Extent_t *extent = &batch->extents[i];
+    if (extent->address < device_in_flight_start) {
+      device_in_flight_start = extent->address;
+    }
+    if (extent->address + extent->size > device_in_flight_end) {
+      device_in_flight_end = extent->address + extent->size;
+    }
+  }
+  MEMIO_Status_t status =
+      MEMIO_progv_async(batch->extents, batch->count, device_done, batch);
+  if (status != MEMIO_Status_Ok) {
+    device_in_flight = false;
+    batch->count = 0;
+    batch->used = 0;
+    return LFS_ERR_IO;
+  }
+  return LFS_ERR_OK;
+}
+
+static int erase_queue_submit(const struct lfs_config *c) {
+  if (erase_queue_count == 0) {
+    return LFS_ERR_OK;
+  }
+
+  int err = device_wait();
+  if (err != LFS_ERR_OK) {
+    return err;
+  }
+
+  device_in_flight = true;
+  device_in_flight_start = erase_queue_start * c->block_size;
+  device_in_flight_end =
+      (erase_queue_start + erase_queue_count) * c->block_size;
+  MEMIO_Status_t status = MEMIO_erase_range_async(
+      device_in_flight_start, device_in_flight_end - device_in_flight_start,
+      device_done, NULL);
+  erase_queue_count = 0;
+  if (status != MEMIO_Status_Ok) {
+    device_in_flight = false;
+    return LFS_ERR_IO;
+  }
+  return LFS_ERR_OK;
+}
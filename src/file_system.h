@@ -34,6 +34,7 @@
 #ifndef FILE_SYSTEM_H__
 #define FILE_SYSTEM_H__
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -51,13 +52,109 @@ typedef enum {
                                       doesn't exist */
   FS_Status_File_Does_Not_Exist,   /**< Attempted to access a file that doesn't
                                       exist */
+  FS_Status_Not_Supported,         /**< Operation not supported by the memory
+                                      device or by the file */
+  FS_Status_Too_Many_Open_Files,   /**< Every file handle is already in use */
 } FS_Status_t;
 
+/**
+ * @brief Flags of FS_open(), combined with a bitwise OR.
+ */
+typedef enum {
+  FS_Open_Read = 1 << 0,     /**< Allow reading */
+  FS_Open_Write = 1 << 1,    /**< Allow writing */
+  FS_Open_Create = 1 << 2,   /**< Create the file if it doesn't exist */
+  FS_Open_Truncate = 1 << 3, /**< Discard the previous contents */
+  FS_Open_Append = 1 << 4,   /**< Write at the end of the file */
+} FS_Open_Flags_t;
+
+/**
+ * @brief Reference point of FS_seek().
+ */
+typedef enum {
+  FS_Seek_Set, /**< From the start of the file */
+  FS_Seek_Cur, /**< From the current position */
+  FS_Seek_End, /**< From the end of the file */
+} FS_Seek_Origin_t;
+
+/* Longest name of a directory entry, as configured in littlefs. */
+#define FS_NAME_MAX 255
+
+/**
+ * @brief Type of a directory entry.
+ */
+typedef enum {
+  FS_Entry_File,
+  FS_Entry_Folder,
+} FS_Entry_Type_t;
+
+/**
+ * @brief Directory entry returned by FS_list_dir().
+ */
+typedef struct {
+  char name[FS_NAME_MAX + 1];
+  FS_Entry_Type_t type;
+  size_t size; /**< Size of a file in bytes, 0 for a folder */
+} FS_Dir_Entry_t;
+
+/**
+ * @brief Position of a directory listing, to resume it with FS_list_dir().
+ *
+ * Zero initialize it to list from the first entry.
+ */
+typedef struct {
+  uint32_t position;
+  bool end; /**< Set once every entry has been returned */
+} FS_Dir_Cursor_t;
+
+/**
+ * @brief Handle of an open file.
+ */
+typedef struct FS_File FS_File_t;
+
+/**
+ * @brief File system statistics.
+ *
+ * Counters of the block device operations performed since FS_init().
+ */
+typedef struct {
+  uint32_t erases_requested; /**< Block erases requested by the file system */
+  uint32_t erases_avoided;   /**< Erases skipped because the block was already
+                                blank */
+  uint32_t path_cache_hits;   /**< Directory lookups served by the cache */
+  uint32_t path_cache_misses; /**< Directory lookups done by the file system */
+} FS_Stats_t;
+
+/**
+ * @brief Block device operations reported to the trace callback.
+ */
+typedef enum {
+  FS_Trace_Read, /**< Data read, or checksummed or compared on the device */
+  FS_Trace_Prog,
+  FS_Trace_Erase,
+  FS_Trace_Sync,
+} FS_Trace_Op_t;
+
+/**
+ * @brief Callback invoked for every block device operation.
+ *
+ * @param op Operation requested by the file system.
+ * @param address Memory address of the operation, 0 for a sync.
+ * @param size Size in bytes, the block size for an erase and 0 for a sync.
+ * @param data Data read or programmed, NULL when there is none or when a read
+ * was served on the device without transferring the data.
+ * @param context User context passed to FS_set_trace().
+ */
+typedef void (*FS_Trace_Callback_t)(FS_Trace_Op_t op, uint32_t address,
+                                    uint32_t size, const void *data,
+                                    void *context);
+
 /**
  * @brief Initialize the file system.
  *
  * Initializes the file system by mounting it if available, or by formatting
- * and then mounting it if it's not available.
+ * and then mounting it if it's not available. A transaction cut short by a
+ * power loss is then finished if it was committed, or dropped otherwise.
  *
  * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
  */
@@ -77,12 +174,13 @@ FS_Status_t FS_deinit(void);
  * @brief Create a new folder in the file system.
  *
  * Creates a folder at the specified path. If intermediate directories
- * in the path don't exist, they will be created automatically.
+ * in the path don't exist, they will be created automatically. The "/.txn"
+ * folder is reserved for transactions.
  *
  * @param path The path where the folder should be created.
  * @return FS_Status_Ok if successful,
  *         FS_Status_Folder_Already_Exists if folder already exists,
- *         FS_Status_Err otherwise.
+ *         FS_Status_Err otherwise, including for a reserved path.
  */
 FS_Status_t FS_create_folder(const char *path);
 
@@ -103,6 +201,45 @@ FS_Status_t FS_create_folder(const char *path);
 FS_Status_t FS_save_to_file(const char *directory_path, const char *file_name,
                             const uint8_t *data, const size_t data_size);
 
+/**
+ * @brief Append data to the end of a file.
+ *
+ * The file is created if it doesn't exist. Appends smaller than the append
+ * threshold are collected in RAM and written together once the threshold is
+ * reached, when another file is appended to, or before any other operation
+ * on files. Each write costs about the bytes appended, not the file size.
+ * Collected data is lost if power fails before it is written: use
+ * FS_flush_appends() to bound that window, e.g. from a periodic timer.
+ *
+ * @param directory_path Path to the directory containing the file.
+ * @param file_name Name of the file to append to.
+ * @param data Pointer to the data to append.
+ * @param data_size Size of the data in bytes.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_Err otherwise, including when collected appends could not
+ *         be written.
+ */
+FS_Status_t FS_append_to_file(const char *directory_path, const char *file_name,
+                              const uint8_t *data, const size_t data_size);
+
+/**
+ * @brief Write the appends collected in RAM to their file.
+ *
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_flush_appends(void);
+
+/**
+ * @brief Set how many bytes of appends are collected before writing them.
+ *
+ * @param threshold Size in bytes, at most FS_APPEND_BUFFER_SIZE (256 unless
+ * overridden at build time). 0 writes every append immediately.
+ * @return FS_Status_Ok if successful, FS_Status_Err if the threshold is too
+ * large or collected appends could not be written.
+ */
+FS_Status_t FS_set_append_threshold(size_t threshold);
+
 /**
  * @brief Get the size of a file.
  *
@@ -138,4 +275,241 @@ FS_Status_t FS_get_file_size(const char *directory_path, const char *file_name,
 FS_Status_t FS_read_from_file(const char *directory_path, const char *file_name,
                               uint8_t *output_data);
 
+/**
+ * @brief Read a range of a file.
+ *
+ * Only the blocks holding the range are read, so the cost depends on the
+ * length of the range rather than on the size of the file.
+ *
+ * @param directory_path Path to the directory containing the file.
+ * @param file_name Name of the file to read.
+ * @param offset Offset within the file where the range starts.
+ * @param length Number of bytes to read.
+ * @param output_data Pointer to the buffer where the data will be stored.
+ * @param output_read Pointer where the number of bytes read will be stored,
+ * less than length if the range goes past the end of the file.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_File_Does_Not_Exist if the file doesn't exist,
+ *         FS_Status_Err otherwise (including an offset past the end of file).
+ */
+FS_Status_t FS_read_range(const char *directory_path, const char *file_name,
+                          size_t offset, size_t length, uint8_t *output_data,
+                          size_t *output_read);
+
+/**
+ * @brief List the entries of a directory.
+ *
+ * Fills the array with the entries that follow the cursor, in a single pass
+ * over the directory, and advances the cursor past them. Call it again with
+ * the same cursor until its end flag is set to walk directories larger than
+ * the array. The "." and ".." entries are not listed, nor is the "/.txn"
+ * folder used by transactions.
+ *
+ * @param directory_path Path to the directory to list.
+ * @param output_entries Array where the entries will be stored.
+ * @param max_entries Number of entries the array can hold.
+ * @param cursor Position to list from, updated to where the listing stopped.
+ * @param output_count Pointer where the number of entries stored will be
+ * stored.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_Err otherwise.
+ */
+FS_Status_t FS_list_dir(const char *directory_path,
+                        FS_Dir_Entry_t *output_entries, size_t max_entries,
+                        FS_Dir_Cursor_t *cursor, size_t *output_count);
+
+/**
+ * @brief Map a part of a file for direct, zero-copy access.
+ *
+ * Returns a pointer to the file data starting at the given offset, read
+ * straight from the memory-mapped flash device. Only the extent that is
+ * contiguous on flash is returned, which ends at the end of a file system block
+ * or of the file. Call it again with the offset advanced by the returned size
+ * to walk through the whole file.
+ *
+ * The pointer remains valid until the next operation that writes to the file
+ * system.
+ *
+ * @param directory_path Path to the directory containing the file.
+ * @param file_name Name of the file to map.
+ * @param offset Offset within the file where the extent starts.
+ * @param output_data Pointer where the address of the extent will be stored.
+ * @param output_size Pointer where the size of the extent will be stored.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_File_Does_Not_Exist if the file doesn't exist,
+ *         FS_Status_Not_Supported if the device is not memory-mapped or the
+ *         file is small enough to be stored inline in its directory (use
+ *         FS_read_from_file() instead),
+ *         FS_Status_Err otherwise (including an offset past the end of file).
+ */
+FS_Status_t FS_map_file(const char *directory_path, const char *file_name,
+                        size_t offset, const uint8_t **output_data,
+                        size_t *output_size);
+
+/**
+ * @brief Open a file for streaming access.
+ *
+ * Handles come from a fixed pool, each with its own cache, so several files
+ * can be open at once without dynamic allocation. They are closed by
+ * FS_deinit() and invalidated by FS_init().
+ *
+ * @param directory_path Path to the directory containing the file.
+ * @param file_name Name of the file to open.
+ * @param flags FS_Open_Flags_t values combined with a bitwise OR.
+ * @param output_file Pointer where the handle will be stored.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_File_Does_Not_Exist if the file doesn't exist and
+ *         FS_Open_Create is not given,
+ *         FS_Status_Too_Many_Open_Files if every handle is in use,
+ *         FS_Status_Err otherwise.
+ */
+FS_Status_t FS_open(const char *directory_path, const char *file_name,
+                    int flags, FS_File_t **output_file);
+
+/**
+ * @brief Read from the current position of a file.
+ *
+ * @param file Handle of a file opened with FS_Open_Read.
+ * @param output_data Pointer to the buffer where the data will be stored.
+ * @param size Number of bytes to read.
+ * @param output_read Pointer where the number of bytes read will be stored,
+ * less than size at the end of the file.
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_read(FS_File_t *file, uint8_t *output_data, size_t size,
+                    size_t *output_read);
+
+/**
+ * @brief Write at the current position of a file.
+ *
+ * The data is cached and only reaches the file once the cache fills up or
+ * the file is synchronized or closed.
+ *
+ * @param file Handle of a file opened with FS_Open_Write.
+ * @param data Pointer to the data to write.
+ * @param size Size of the data in bytes.
+ * @return FS_Status_Ok if all the data was written, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_write(FS_File_t *file, const uint8_t *data, size_t size);
+
+/**
+ * @brief Move the current position of a file.
+ *
+ * @param file Handle of an open file.
+ * @param offset Offset relative to the origin, in bytes.
+ * @param origin Reference point of the offset.
+ * @param output_position Pointer where the new position will be stored, or
+ * NULL.
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_seek(FS_File_t *file, int32_t offset, FS_Seek_Origin_t origin,
+                    size_t *output_position);
+
+/**
+ * @brief Commit the data written to a file so far.
+ *
+ * @param file Handle of an open file.
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_sync(FS_File_t *file);
+
+/**
+ * @brief Close a file and release its handle.
+ *
+ * Pending data is committed first. The handle is released even if that fails.
+ *
+ * @param file Handle of an open file.
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_close(FS_File_t *file);
+
+/**
+ * @brief Start a transaction that updates several files at once.
+ *
+ * Files written with FS_txn_write() keep their old contents until
+ * FS_txn_commit() publishes all of them at once, so a power loss leaves either
+ * every file updated or none. A transaction cut short after it was committed
+ * is finished by the next FS_init().
+ *
+ * @return FS_Status_Ok if successful, FS_Status_Err if a transaction is
+ * already in progress.
+ */
+FS_Status_t FS_txn_begin(void);
+
+/**
+ * @brief Stage the new contents of a file in the current transaction.
+ *
+ * The target is opened and truncated, and the contents are written without
+ * being committed, so storage keeps the old contents. Each staged file holds
+ * one of FS_TXN_FILES_MAX handles reserved for transactions until the
+ * transaction ends. A target that does not exist yet is created empty. Staging
+ * a file twice keeps the last contents.
+ *
+ * @param directory_path Path to the directory containing the file.
+ * @param file_name Name of the file to replace.
+ * @param data Pointer to the new contents.
+ * @param size Size of the new contents in bytes.
+ * @return FS_Status_Ok if successful,
+ *         FS_Status_Folder_Does_Not_Exist if the directory doesn't exist,
+ *         FS_Status_Too_Many_Open_Files if FS_TXN_FILES_MAX files are
+ *         already staged,
+ *         FS_Status_Err otherwise, including when no transaction is in
+ *         progress.
+ */
+FS_Status_t FS_txn_write(const char *directory_path, const char *file_name,
+                         const uint8_t *data, size_t size);
+
+/**
+ * @brief Publish every file staged in the current transaction.
+ *
+ * Files whose entries share a metadata pair, such as files of a directory
+ * that has not been split, are published together by a single metadata
+ * commit. Otherwise the files are copied to temporary files in the reserved
+ * "/.txn" folder and a journal listing them is written in a single commit,
+ * which is the point the transaction takes effect at. Each temporary file is
+ * then renamed over its target and the folder is removed. The transaction ends
+ * and its handles are released whatever the outcome; when nothing was
+ * committed no file is updated.
+ *
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_txn_commit(void);
+
+/**
+ * @brief Drop every file staged in the current transaction.
+ *
+ * The staged contents are discarded and the targets keep their contents.
+ *
+ * @return FS_Status_Ok if successful, FS_Status_Err if no transaction is in
+ * progress.
+ */
+FS_Status_t FS_txn_abort(void);
+
+/**
+ * @brief Get the file system statistics.
+ *
+ * @param output_stats Pointer where the statistics will be stored.
+ * @return FS_Status_Ok if successful, FS_Status_Err otherwise.
+ */
+FS_Status_t FS_get_stats(FS_Stats_t *output_stats);
+
+/**
+ * @brief Set the callback that traces the block device operations.
+ *
+ * The callback sees the operations as requested by the file system, before
+ * they are batched or queued. Erases of blocks found blank are skipped and
+ * not reported. Reads are reported once they complete, the other operations
+ * when they are requested. It stays set across
+ * FS_init() and FS_deinit(), so mounting can be traced too.
+ *
+ * @param callback Function to call, NULL to stop tracing.
+ * @param context User context passed to the callback.
+ * @return FS_Status_Ok.
+ */
+FS_Status_t FS_set_trace(FS_Trace_Callback_t callback, void *context);
+
 #endif /* FILE_SYSTEM_H__ */
\ No newline at end of file
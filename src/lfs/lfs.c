@@ -124,6 +124,21 @@ static int lfs_bd_read(lfs_t *lfs,
     return 0;
 }
 
+static bool lfs_bd_cached(const lfs_cache_t *cache,
+        lfs_block_t block, lfs_off_t off, lfs_size_t size) {
+    return cache && block == cache->block &&
+            off < cache->off + cache->size && cache->off < off + size;
+}
+
+static bool lfs_bd_offload(
+        const lfs_cache_t *pcache, const lfs_cache_t *rcache,
+        lfs_size_t hint, lfs_block_t block, lfs_off_t off, lfs_size_t size) {
+    // only hand off regions that would bypass the caches anyway
+    return size >= hint
+            && !lfs_bd_cached(pcache, block, off, size)
+            && !lfs_bd_cached(rcache, block, off, size);
+}
+
 static int lfs_bd_cmp(lfs_t *lfs,
         const lfs_cache_t *pcache, lfs_cache_t *rcache, lfs_size_t hint,
         lfs_block_t block, lfs_off_t off,
@@ -131,6 +146,25 @@ static int lfs_bd_cmp(lfs_t *lfs,
     const uint8_t *data = buffer;
     lfs_size_t diff = 0;
 
+    if (lfs->cfg->cmp &&
+            lfs_bd_offload(pcache, rcache, hint, block, off, size)) {
+        if (off+size > lfs->cfg->block_size
+                || (lfs->block_count && block >= lfs->block_count)) {
+            return LFS_ERR_CORRUPT;
+        }
+
+        int res = 0;
+        int err = lfs->cfg->cmp(lfs->cfg, block, off, buffer, size, &res);
+        LFS_ASSERT(err <= 0);
+        if (err) {
+            return err;
+        }
+
+        return res < 0 ? LFS_CMP_LT
+                : res > 0 ? LFS_CMP_GT
+                : LFS_CMP_EQ;
+    }
+
     for (lfs_off_t i = 0; i < size; i += diff) {
         uint8_t dat[8];
 
@@ -156,6 +190,18 @@ static int lfs_bd_crc(lfs_t *lfs,
         lfs_block_t block, lfs_off_t off, lfs_size_t size, uint32_t *crc) {
     lfs_size_t diff = 0;
 
+    if (lfs->cfg->crc &&
+            lfs_bd_offload(pcache, rcache, hint, block, off, size)) {
+        if (off+size > lfs->cfg->block_size
+                || (lfs->block_count && block >= lfs->block_count)) {
+            return LFS_ERR_CORRUPT;
+        }
+
+        int err = lfs->cfg->crc(lfs->cfg, block, off, size, crc);
+        LFS_ASSERT(err <= 0);
+        return err;
+    }
+
     for (lfs_off_t i = 0; i < size; i += diff) {
         uint8_t dat[8];
         diff = lfs_min(size-i, sizeof(dat));
@@ -565,6 +611,8 @@ static lfs_ssize_t lfs_file_flushedwrite(lfs_t *lfs, lfs_file_t *file,
 static lfs_ssize_t lfs_file_write_(lfs_t *lfs, lfs_file_t *file,
         const void *buffer, lfs_size_t size);
 static int lfs_file_sync_(lfs_t *lfs, lfs_file_t *file);
+static int lfs_file_syncv_(lfs_t *lfs,
+        lfs_file_t *const *files, lfs_size_t count);
 static int lfs_file_outline(lfs_t *lfs, lfs_file_t *file);
 static int lfs_file_flush(lfs_t *lfs, lfs_file_t *file);
 
@@ -1494,6 +1542,17 @@ static lfs_stag_t lfs_dir_find(lfs_t *lfs, lfs_mdir_t *dir,
         return LFS_ERR_INVAL;
     }
 
+    // start from a directory the user already resolved, if any
+    if (lfs->cfg->dir_lookup) {
+        lfs_size_t len = 0;
+        lfs_block_t pair[2];
+        if (lfs->cfg->dir_lookup(lfs->cfg, name, &len, pair)) {
+            dir->tail[0] = pair[0];
+            dir->tail[1] = pair[1];
+            name += len;
+        }
+    }
+
     while (true) {
 nextname:
         // skip slashes if we're a directory
@@ -2481,6 +2540,11 @@ static int lfs_dir_orphaningcommit(lfs_t *lfs, lfs_mdir_t *dir,
             lfs->root[1] = ldir.pair[1];
         }
 
+        // update pairs cached by the user
+        if (lfs->cfg->dir_relocate) {
+            lfs->cfg->dir_relocate(lfs->cfg, lpair, ldir.pair);
+        }
+
         // update internally tracked dirs
         for (struct lfs_mlist *d = lfs->mlist; d; d = d->next) {
             if (lfs_pair_cmp(lpair, d->m.pair) == 0) {
@@ -2761,6 +2825,34 @@ static int lfs_dir_open_(lfs_t *lfs, lfs_dir_t *dir, const char *path) {
     return 0;
 }
 
+static int lfs_dir_pair_(lfs_t *lfs, const char *path, lfs_block_t pair[2]) {
+    lfs_mdir_t cwd;
+    lfs_stag_t tag = lfs_dir_find(lfs, &cwd, &path, NULL);
+    if (tag < 0) {
+        return tag;
+    }
+
+    if (lfs_tag_type3(tag) != LFS_TYPE_DIR) {
+        return LFS_ERR_NOTDIR;
+    }
+
+    if (lfs_tag_id(tag) == 0x3ff) {
+        // handle root dir separately
+        pair[0] = lfs->root[0];
+        pair[1] = lfs->root[1];
+        return 0;
+    }
+
+    // get dir pair from parent
+    lfs_stag_t res = lfs_dir_get(lfs, &cwd, LFS_MKTAG(0x700, 0x3ff, 0),
+            LFS_MKTAG(LFS_TYPE_STRUCT, lfs_tag_id(tag), 8), pair);
+    if (res < 0) {
+        return res;
+    }
+    lfs_pair_fromle32(pair);
+    return 0;
+}
+
 static int lfs_dir_close_(lfs_t *lfs, lfs_dir_t *dir) {
     // remove from list of mdirs
     lfs_mlist_remove(lfs, (struct lfs_mlist *)dir);
@@ -3488,6 +3580,106 @@ static int lfs_file_sync_(lfs_t *lfs, lfs_file_t *file) {
 }
 #endif
 
+#ifndef LFS_READONLY
+static int lfs_file_syncv_(lfs_t *lfs,
+        lfs_file_t *const *files, lfs_size_t count) {
+    if (count > LFS_SYNCV_MAX) {
+        return LFS_ERR_INVAL;
+    }
+
+    // write out any pending data, nothing is committed yet
+    bool outlined = false;
+    lfs_file_t *first = NULL;
+    for (lfs_size_t i = 0; i < count; i++) {
+        lfs_file_t *file = files[i];
+        if (file->flags & LFS_F_ERRED) {
+            // it's not safe to commit a file that errored
+            return LFS_ERR_INVAL;
+        }
+
+        int err = lfs_file_flush(lfs, file);
+        if (err) {
+            file->flags |= LFS_F_ERRED;
+            return err;
+        }
+
+        if (!(file->flags & LFS_F_DIRTY) || lfs_pair_isnull(file->m.pair)) {
+            continue;
+        }
+
+        // a single commit can only cover a single metadata pair
+        if (first && lfs_pair_cmp(file->m.pair, first->m.pair) != 0) {
+            return LFS_ERR_INVAL;
+        }
+
+        first = (first) ? first : file;
+        outlined |= !(file->flags & LFS_F_INLINE);
+    }
+
+    if (!first) {
+        return 0;
+    }
+
+    // before we commit metadata, we need sync the disk to make sure
+    // data writes don't complete after metadata writes
+    if (outlined) {
+        int err = lfs_bd_sync(lfs, &lfs->pcache, &lfs->rcache, false);
+        if (err) {
+            return err;
+        }
+    }
+
+    // gather the dir entries of every dirty file into one commit
+    struct lfs_mattr attrs[2*LFS_SYNCV_MAX];
+    struct lfs_ctz ctzs[LFS_SYNCV_MAX];
+    int attrcount = 0;
+    for (lfs_size_t i = 0; i < count; i++) {
+        lfs_file_t *file = files[i];
+        if (!(file->flags & LFS_F_DIRTY) || lfs_pair_isnull(file->m.pair)) {
+            continue;
+        }
+
+        if (file->flags & LFS_F_INLINE) {
+            // inline the whole file
+            attrs[attrcount].tag = LFS_MKTAG(LFS_TYPE_INLINESTRUCT,
+                    file->id, file->ctz.size);
+            attrs[attrcount].buffer = file->cache.buffer;
+        } else {
+            // copy ctz so alloc will work during a relocate
+            ctzs[i] = file->ctz;
+            lfs_ctz_tole32(&ctzs[i]);
+            attrs[attrcount].tag = LFS_MKTAG(LFS_TYPE_CTZSTRUCT,
+                    file->id, sizeof(ctzs[i]));
+            attrs[attrcount].buffer = &ctzs[i];
+        }
+        attrcount += 1;
+
+        attrs[attrcount].tag = LFS_MKTAG(LFS_FROM_USERATTRS,
+                file->id, file->cfg->attr_count);
+        attrs[attrcount].buffer = file->cfg->attrs;
+        attrcount += 1;
+    }
+
+    // commit file data and attributes, the other files share the
+    // metadata pair and are updated through the mlist
+    int err = lfs_dir_commit(lfs, &first->m, attrs, attrcount);
+    for (lfs_size_t i = 0; i < count; i++) {
+        lfs_file_t *file = files[i];
+        if (!(file->flags & LFS_F_DIRTY) || lfs_pair_isnull(file->m.pair)) {
+            continue;
+        }
+
+        if (err) {
+            file->flags |= LFS_F_ERRED;
+        } else {
+            file->flags &= ~LFS_F_DIRTY;
+        }
+    }
+
+    return err;
+}
+#endif
+
 static lfs_ssize_t lfs_file_flushedread(lfs_t *lfs, lfs_file_t *file,
         void *buffer, lfs_size_t size) {
     uint8_t *data = buffer;
@@ -3857,6 +4049,31 @@ static lfs_soff_t lfs_file_size_(lfs_t *lfs, lfs_file_t *file) {
     return file->ctz.size;
 }
 
+static int lfs_file_extent_(lfs_t *lfs, lfs_file_t *file, lfs_off_t pos,
+        lfs_block_t *block, lfs_off_t *off, lfs_size_t *size) {
+#ifndef LFS_READONLY
+    if (file->flags & LFS_F_WRITING) {
+        int err = lfs_file_flush(lfs, file);
+        if (err) {
+            return err;
+        }
+    }
+#endif
+
+    if ((file->flags & LFS_F_INLINE) || pos >= file->ctz.size) {
+        return LFS_ERR_INVAL;
+    }
+
+    int err = lfs_ctz_find(lfs, NULL, &file->cache,
+            file->ctz.head, file->ctz.size, pos, block, off);
+    if (err) {
+        return err;
+    }
+
+    *size = lfs_min(lfs->cfg->block_size - *off, file->ctz.size - pos);
+    return 0;
+}
+
 
 /// General fs operations ///
 static int lfs_stat_(lfs_t *lfs, const char *path, struct lfs_info *info) {
@@ -6204,6 +6421,26 @@ int lfs_file_sync(lfs_t *lfs, lfs_file_t *file) {
 }
 #endif
 
+#ifndef LFS_READONLY
+int lfs_file_syncv(lfs_t *lfs, lfs_file_t *const *files, lfs_size_t count) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_file_syncv(%p, %p, %"PRIu32")",
+            (void*)lfs, (void*)files, count);
+    for (lfs_size_t i = 0; i < count; i++) {
+        LFS_ASSERT(lfs_mlist_isopen(lfs->mlist, (struct lfs_mlist*)files[i]));
+    }
+
+    err = lfs_file_syncv_(lfs, files, count);
+
+    LFS_TRACE("lfs_file_syncv -> %d", err);
+    LFS_UNLOCK(lfs->cfg);
+    return err;
+}
+#endif
+
 lfs_ssize_t lfs_file_read(lfs_t *lfs, lfs_file_t *file,
         void *buffer, lfs_size_t size) {
     int err = LFS_LOCK(lfs->cfg);
@@ -6319,6 +6556,23 @@ lfs_soff_t lfs_file_size(lfs_t *lfs, lfs_file_t *file) {
     return res;
 }
 
+int lfs_file_extent(lfs_t *lfs, lfs_file_t *file, lfs_off_t pos,
+        lfs_block_t *block, lfs_off_t *off, lfs_size_t *size) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_file_extent(%p, %p, %"PRIu32")",
+            (void*)lfs, (void*)file, pos);
+    LFS_ASSERT(lfs_mlist_isopen(lfs->mlist, (struct lfs_mlist*)file));
+
+    err = lfs_file_extent_(lfs, file, pos, block, off, size);
+
+    LFS_TRACE("lfs_file_extent -> %d", err);
+    LFS_UNLOCK(lfs->cfg);
+    return err;
+}
+
 #ifndef LFS_READONLY
 int lfs_mkdir(lfs_t *lfs, const char *path) {
     int err = LFS_LOCK(lfs->cfg);
@@ -6350,6 +6604,20 @@ int lfs_dir_open(lfs_t *lfs, lfs_dir_t *dir, const char *path) {
     return err;
 }
 
+int lfs_dir_pair(lfs_t *lfs, const char *path, lfs_block_t pair[2]) {
+    int err = LFS_LOCK(lfs->cfg);
+    if (err) {
+        return err;
+    }
+    LFS_TRACE("lfs_dir_pair(%p, \"%s\", %p)", (void*)lfs, path, (void*)pair);
+
+    err = lfs_dir_pair_(lfs, path, pair);
+
+    LFS_TRACE("lfs_dir_pair -> %d", err);
+    LFS_UNLOCK(lfs->cfg);
+    return err;
+}
+
 int lfs_dir_close(lfs_t *lfs, lfs_dir_t *dir) {
     int err = LFS_LOCK(lfs->cfg);
     if (err) {
@@ -65,6 +65,12 @@ typedef uint32_t lfs_block_t;
 #define LFS_ATTR_MAX 1022
 #endif
 
+// Maximum number of files lfs_file_syncv can commit at once, may be redefined
+// to trade stack usage for larger groups. Not stored on disk.
+#ifndef LFS_SYNCV_MAX
+#define LFS_SYNCV_MAX 8
+#endif
+
 // Possible error codes, these are negative to allow
 // valid positive return values
 enum lfs_error {
@@ -180,6 +186,34 @@ struct lfs_config {
     // are propagated to the user.
     int (*sync)(const struct lfs_config *c);
 
+    // Optional. Continue the CRC-32 in *crc over a region in a block without
+    // reading it back, e.g. with a DMA CRC unit. Uses the same polynomial and
+    // convention as lfs_crc. When NULL littlefs reads the region and computes
+    // the CRC itself. Negative error codes are propagated to the user.
+    int (*crc)(const struct lfs_config *c, lfs_block_t block,
+            lfs_off_t off, lfs_size_t size, uint32_t *crc);
+
+    // Optional. Compare a region in a block with the buffer without reading
+    // it back. Stores <0, 0 or >0 in *res like memcmp with the stored data
+    // as first operand. When NULL littlefs reads the region and compares it
+    // itself. Negative error codes are propagated to the user.
+    int (*cmp)(const struct lfs_config *c, lfs_block_t block,
+            lfs_off_t off, const void *buffer, lfs_size_t size, int *res);
+
+    // Optional. Resolve the directory part of a path without walking it from
+    // the root, e.g. from a cache of pairs returned by lfs_dir_pair. On a hit
+    // stores the length of a directory prefix of path, which must be followed
+    // by a name, and the metadata pair of that directory, and returns true.
+    // Cached pairs must follow the directories through dir_relocate.
+    bool (*dir_lookup)(const struct lfs_config *c, const char *path,
+            lfs_size_t *len, lfs_block_t pair[2]);
+
+    // Optional. Called when a metadata pair moves to other blocks, because a
+    // block went bad or wore out. Pairs cached for dir_lookup that match
+    // oldpair, in either order, must be replaced by newpair.
+    void (*dir_relocate)(const struct lfs_config *c,
+            const lfs_block_t oldpair[2], const lfs_block_t newpair[2]);
+
 #ifdef LFS_THREADSAFE
     // Lock the underlying block device. Negative error codes
     // are propagated to the user.
@@ -606,6 +640,20 @@ int lfs_file_close(lfs_t *lfs, lfs_file_t *file);
 // Returns a negative error code on failure.
 int lfs_file_sync(lfs_t *lfs, lfs_file_t *file);
 
+#ifndef LFS_READONLY
+// Synchronize several files on storage in a single metadata commit
+//
+// Pending writes of every file are written out first, then the new contents
+// of all of them are published by one commit, so either every file is updated
+// or none is. The dirty files must share a metadata pair, which holds for
+// files of the same directory as long as it has not been split. At most
+// LFS_SYNCV_MAX files can be synchronized at once.
+//
+// Returns LFS_ERR_INVAL without committing anything if the files span
+// several metadata pairs, or a negative error code on failure.
+int lfs_file_syncv(lfs_t *lfs, lfs_file_t *const *files, lfs_size_t count);
+#endif
+
 // Read data from file
 //
 // Takes a buffer and size indicating where to store the read data.
@@ -656,6 +704,16 @@ int lfs_file_rewind(lfs_t *lfs, lfs_file_t *file);
 // Returns the size of the file, or a negative error code on failure.
 lfs_soff_t lfs_file_size(lfs_t *lfs, lfs_file_t *file);
 
+// Find where the data of the file at the given position is stored
+//
+// Stores the block and the offset in it holding the byte at pos, and the
+// number of bytes stored contiguously from there, up to the end of the block
+// or of the file. Pending writes are flushed first. Returns LFS_ERR_INVAL if
+// the file is inline or pos is past its end, or a negative error code on
+// failure.
+int lfs_file_extent(lfs_t *lfs, lfs_file_t *file, lfs_off_t pos,
+        lfs_block_t *block, lfs_off_t *off, lfs_size_t *size);
+
 
 /// Directory operations ///
 
@@ -672,6 +730,13 @@ int lfs_mkdir(lfs_t *lfs, const char *path);
 // Returns a negative error code on failure.
 int lfs_dir_open(lfs_t *lfs, lfs_dir_t *dir, const char *path);
 
+// Find the metadata pair of a directory
+//
+// The pair can be handed back to littlefs through the dir_lookup callback.
+// Returns LFS_ERR_NOTDIR if the path is not a directory, or a negative error
+// code on failure.
+int lfs_dir_pair(lfs_t *lfs, const char *path, lfs_block_t pair[2]);
+
 // Close a directory
 //
 // Releases any allocated resources.
@@ -36,6 +36,7 @@
 #ifndef MEMORY_IO_H__
 #define MEMORY_IO_H__
 
+#include <stdbool.h>
 #include <stdint.h>
 
 /**
@@ -48,6 +49,53 @@ typedef enum {
   MEMIO_Status_Err, /**< Operation failed */
 } MEMIO_Status_t;
 
+/**
+ * @brief Memory extent for vectored (scatter/gather) operations.
+ *
+ * Describes a contiguous region of the NOR flash memory and the buffer that
+ * holds (or receives) its contents.
+ */
+typedef struct {
+  uint32_t address; /**< Starting memory address of the extent */
+  void *buffer;     /**< Buffer holding or receiving the extent data */
+  uint32_t size;    /**< Number of bytes in the extent */
+} MEMIO_Extent_t;
+
+/**
+ * @brief NOR flash memory geometry.
+ *
+ * Describes the device as reported by its JEDEC ID and SFDP parameter table, so
+ * upper layers can adapt to the part fitted on the board.
+ */
+typedef struct {
+  uint32_t jedec_id;    /**< Manufacturer, memory type and capacity ID bytes
+                           (e.g. 0xC84015 for the GD25Q16C) */
+  uint32_t size;        /**< Total capacity in bytes */
+  uint32_t page_size;   /**< Largest program unit in bytes */
+  uint32_t sector_size; /**< Smallest erase unit in bytes */
+  uint32_t block_size;  /**< Largest block erase unit in bytes; half-block
+                           erase is also supported */
+} MEMIO_Geometry_t;
+
+/**
+ * @brief Completion callback of an asynchronous memory operation.
+ *
+ * @param status Result of the operation.
+ * @param context User context given when the operation was submitted.
+ */
+typedef void (*MEMIO_Callback_t)(MEMIO_Status_t status, void *context);
+
+/**
+ * @brief Get the geometry of the NOR flash memory.
+ *
+ * This function identifies the device (JEDEC ID and SFDP table) and reports
+ * its capacity and program/erase granularities.
+ *
+ * @param geometry Pointer where the geometry will be stored.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_get_geometry(MEMIO_Geometry_t *geometry);
+
 /**
  * @brief Read data from NOR flash memory.
  *
@@ -61,6 +109,65 @@ typedef enum {
  */
 MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size);
 
+/**
+ * @brief Check whether a region of NOR flash memory is erased.
+ *
+ * This function reports whether every byte of the region reads as 0xFF, which
+ * lets callers skip erasing a region that is already blank.
+ *
+ * @param address The starting memory address of the region.
+ * @param size Size of the region in bytes.
+ * @param erased Pointer where the result will be stored.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_is_erased(uint32_t address, uint32_t size, bool *erased);
+
+/**
+ * @brief Compute the CRC-32 of a region of NOR flash memory.
+ *
+ * This function continues the CRC-32 passed in crc over the region without
+ * transferring it to the caller, e.g. using a DMA CRC unit. It uses the
+ * reflected polynomial 0xEDB88320 without initial or final inversion, as
+ * littlefs does.
+ *
+ * @param address The starting memory address of the region.
+ * @param size Size of the region in bytes.
+ * @param crc Pointer to the running CRC, updated in place.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_crc32(uint32_t address, uint32_t size, uint32_t *crc);
+
+/**
+ * @brief Compare a region of NOR flash memory with a buffer.
+ *
+ * This function compares the region with the buffer without transferring it
+ * to the caller. The result follows memcmp() with the memory contents as the
+ * first operand.
+ *
+ * @param address The starting memory address of the region.
+ * @param buffer Pointer to the data to compare with.
+ * @param size Size of the region in bytes.
+ * @param result Pointer where the comparison result will be stored.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_compare(uint32_t address, const void *buffer,
+                             uint32_t size, int *result);
+
+/**
+ * @brief Map a region of NOR flash memory for direct access.
+ *
+ * When the device is memory-mapped (e.g. QSPI in execute-in-place mode), this
+ * function returns a pointer through which the region can be read without
+ * copying. The pointer is only valid while no program or erase operation is in
+ * progress, and until the region is programmed or erased again.
+ *
+ * @param address The starting memory address of the region.
+ * @param size Size of the region in bytes.
+ * @return Pointer to the region, or NULL if the device is not memory-mapped or
+ * is busy.
+ */
+const void *MEMIO_map(uint32_t address, uint32_t size);
+
 /**
  * @brief Program (write) data to NOR flash memory.
  *
@@ -68,6 +175,11 @@ MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size);
  * requires the target memory to be in an erased state before programming.
  * The function does not automatically erase memory before writing.
  *
+ * The region may span several pages. The driver splits it at page boundaries
+ * and issues the page program commands back to back under a single
+ * write-enable and status-poll loop, so one large request costs one command
+ * setup instead of one per page.
+ *
  * @param address The starting memory address to write to (must be properly
  * aligned).
  * @param buffer Pointer to the data to be written.
@@ -76,6 +188,34 @@ MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size);
  */
 MEMIO_Status_t MEMIO_prog(uint32_t address, const void *buffer, uint32_t size);
 
+/**
+ * @brief Read several extents from NOR flash memory.
+ *
+ * This function reads every extent of the list in order. Extents whose
+ * addresses are adjacent (the next one starts where the previous one ends)
+ * are merged by the driver into a single continuous read transfer, so the
+ * command and address overhead is paid only once per run of adjacent extents.
+ *
+ * @param extents Array of extents to read.
+ * @param count Number of extents in the array.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_readv(const MEMIO_Extent_t *extents, uint32_t count);
+
+/**
+ * @brief Program (write) several extents to NOR flash memory.
+ *
+ * This function programs every extent of the list in order, with the same
+ * requirements as MEMIO_prog(). Adjacent extents are merged by the driver into
+ * a single continuous program transfer, which is still split at page
+ * boundaries as required by the device.
+ *
+ * @param extents Array of extents to write. The buffers are not modified.
+ * @param count Number of extents in the array.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_progv(const MEMIO_Extent_t *extents, uint32_t count);
+
 /**
  * @brief Erase a block of NOR flash memory.
  *
@@ -89,4 +229,136 @@ MEMIO_Status_t MEMIO_prog(uint32_t address, const void *buffer, uint32_t size);
  */
 MEMIO_Status_t MEMIO_erase(uint32_t address);
 
-#endif /* MEMORY_IO_H__ */
\ No newline at end of file
+/**
+ * @brief Erase a range of NOR flash memory.
+ *
+ * This function erases every sector in the given range using the largest erase
+ * command that fits each aligned part of it: chip erase when the range covers
+ * the whole device, then 64 KiB and 32 KiB block erase, and 4 KiB sector erase
+ * for the rest. Larger erase commands are much faster per byte than repeated
+ * sector erases.
+ *
+ * @param address The starting address of the range (must be sector-aligned).
+ * @param length Length of the range in bytes (must be a multiple of the sector
+ * size).
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMIO_erase_range(uint32_t address, uint32_t length);
+
+/**
+ * @brief Start programming data to NOR flash memory.
+ *
+ * Asynchronous variant of MEMIO_prog(). The function sends the data and the
+ * program command and returns without waiting for the device to finish. Only
+ * one asynchronous operation can be in progress at a time, and no other
+ * operation may be issued until it completes.
+ *
+ * @param address The starting memory address to write to (must be properly
+ * aligned).
+ * @param buffer Pointer to the data to be written. It must stay valid until the
+ * operation completes.
+ * @param size Number of bytes to write.
+ * @param callback Function called once the operation completes, or NULL.
+ * @param context User context passed to the callback.
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMIO_prog_async(uint32_t address, const void *buffer,
+                                uint32_t size, MEMIO_Callback_t callback,
+                                void *context);
+
+/**
+ * @brief Start programming several extents to NOR flash memory.
+ *
+ * Asynchronous variant of MEMIO_progv(). The extent array and its buffers must
+ * stay valid until the operation completes.
+ *
+ * @param extents Array of extents to write.
+ * @param count Number of extents in the array.
+ * @param callback Function called once the operation completes, or NULL.
+ * @param context User context passed to the callback.
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMIO_progv_async(const MEMIO_Extent_t *extents, uint32_t count,
+                                 MEMIO_Callback_t callback, void *context);
+
+/**
+ * @brief Start erasing a block of NOR flash memory.
+ *
+ * Asynchronous variant of MEMIO_erase().
+ *
+ * @param address The starting address of the block to erase (must be
+ * block-aligned).
+ * @param callback Function called once the operation completes, or NULL.
+ * @param context User context passed to the callback.
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMIO_erase_async(uint32_t address, MEMIO_Callback_t callback,
+                                 void *context);
+
+/**
+ * @brief Start erasing a range of NOR flash memory.
+ *
+ * Asynchronous variant of MEMIO_erase_range(). When the range needs several
+ * erase commands, the driver issues them in sequence and calls the callback
+ * once after the last one.
+ *
+ * @param address The starting address of the range (must be sector-aligned).
+ * @param length Length of the range in bytes (must be a multiple of the sector
+ * size).
+ * @param callback Function called once the operation completes, or NULL.
+ * @param context User context passed to the callback.
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMIO_erase_range_async(uint32_t address, uint32_t length,
+                                       MEMIO_Callback_t callback,
+                                       void *context);
+
+/**
+ * @brief Poll whether an asynchronous operation is still in progress.
+ *
+ * This function reads the device status. When it finds that the operation in
+ * progress has finished, it calls the completion callback of that operation
+ * before returning.
+ *
+ * @return true while the device is busy, false once it is ready.
+ */
+bool MEMIO_is_busy(void);
+
+/**
+ * @brief Wait for the asynchronous operation in progress to complete.
+ *
+ * This function polls the device until it is ready, calling the completion
+ * callback of the operation. It returns immediately if nothing is in progress.
+ *
+ * @return Status of the last completed asynchronous operation, or
+ * MEMIO_Status_Err if the operation in progress is suspended.
+ */
+MEMIO_Status_t MEMIO_wait(void);
+
+/**
+ * @brief Suspend the erase or program operation in progress.
+ *
+ * This function suspends the asynchronous operation in progress so that other
+ * parts of the memory can be read. Reading the sector being erased or the page
+ * being programmed is not allowed while suspended, and no other program or
+ * erase operation can be started. MEMIO_is_busy() keeps reporting the device
+ * as busy until the operation is resumed and completes.
+ *
+ * @return MEMIO_Status_Ok if an operation was suspended, MEMIO_Status_Err if no
+ * operation was in progress.
+ */
+MEMIO_Status_t MEMIO_suspend(void);
+
+/**
+ * @brief Resume the suspended erase or program operation.
+ *
+ * @return MEMIO_Status_Ok if the operation was resumed, MEMIO_Status_Err if no
+ * operation was suspended.
+ */
+MEMIO_Status_t MEMIO_resume(void);
+
+#endif /* MEMORY_IO_H__ */
@@ -0,0 +1,150 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file memory_chip_io.h
+ * @brief Per-chip NOR flash memory I/O interface.
+ *
+ * This module is the interface of the driver of each NOR flash chip of a
+ * striped memory (see memory_io_striped.c). Chips are addressed by index and
+ * each one has its own address space starting at zero. Program and erase
+ * operations only start the operation, so that several chips can work in
+ * parallel; MEMCHIP_is_busy() and MEMCHIP_wait() report their progress.
+ */
+
+#ifndef MEMORY_CHIP_IO_H__
+#define MEMORY_CHIP_IO_H__
+
+#include "memory_io.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Get the number of chips of the striped memory.
+ *
+ * @return Number of chips fitted on the board.
+ */
+uint8_t MEMCHIP_get_count(void);
+
+/**
+ * @brief Get the geometry of a chip.
+ *
+ * @param chip Index of the chip.
+ * @param geometry Pointer where the geometry will be stored.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise.
+ */
+MEMIO_Status_t MEMCHIP_get_geometry(uint8_t chip, MEMIO_Geometry_t *geometry);
+
+/**
+ * @brief Read data from a chip.
+ *
+ * @param chip Index of the chip.
+ * @param address The starting address within the chip.
+ * @param buffer Pointer to a buffer where the read data will be stored.
+ * @param size Number of bytes to read.
+ * @return MEMIO_Status_Ok if successful, MEMIO_Status_Err otherwise (including
+ * when the chip is busy).
+ */
+MEMIO_Status_t MEMCHIP_read(uint8_t chip, uint32_t address, void *buffer,
+                            uint32_t size);
+
+/**
+ * @brief Start programming data to a chip.
+ *
+ * The data is sent to the chip before returning, so the buffer can be reused
+ * right away. The size must not cross a page boundary.
+ *
+ * @param chip Index of the chip.
+ * @param address The starting address within the chip.
+ * @param buffer Pointer to the data to be written.
+ * @param size Number of bytes to write.
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise (including when the chip is busy).
+ */
+MEMIO_Status_t MEMCHIP_prog(uint8_t chip, uint32_t address, const void *buffer,
+                            uint32_t size);
+
+/**
+ * @brief Start erasing a range of a chip.
+ *
+ * The chip driver uses the largest erase commands that fit the range, as
+ * MEMIO_erase_range() does.
+ *
+ * @param chip Index of the chip.
+ * @param address The starting address of the range (must be sector-aligned).
+ * @param length Length of the range in bytes (must be a multiple of the sector
+ * size).
+ * @return MEMIO_Status_Ok if the operation was started, MEMIO_Status_Err
+ * otherwise (including when the chip is busy).
+ */
+MEMIO_Status_t MEMCHIP_erase_range(uint8_t chip, uint32_t address,
+                                   uint32_t length);
+
+/**
+ * @brief Poll whether a chip is still programming or erasing.
+ *
+ * @param chip Index of the chip.
+ * @return true while the chip is busy or suspended, false once it is ready.
+ */
+bool MEMCHIP_is_busy(uint8_t chip);
+
+/**
+ * @brief Wait until a chip is ready.
+ *
+ * @param chip Index of the chip.
+ * @return Status of the last program or erase operation of the chip, or
+ * MEMIO_Status_Err if its operation is suspended.
+ */
+MEMIO_Status_t MEMCHIP_wait(uint8_t chip);
+
+/**
+ * @brief Suspend the program or erase operation in progress on a chip.
+ *
+ * @param chip Index of the chip.
+ * @return MEMIO_Status_Ok if an operation was suspended, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMCHIP_suspend(uint8_t chip);
+
+/**
+ * @brief Resume the suspended operation of a chip.
+ *
+ * @param chip Index of the chip.
+ * @return MEMIO_Status_Ok if the operation was resumed, MEMIO_Status_Err
+ * otherwise.
+ */
+MEMIO_Status_t MEMCHIP_resume(uint8_t chip);
+
+/**
+ * @brief Map a region of a chip for direct access.
+ *
+ * @param chip Index of the chip.
+ * @param address The starting address within the chip.
+ * @param size Size of the region in bytes.
+ * @return Pointer to the region, or NULL if the chip is not memory-mapped or is
+ * busy.
+ */
+const void *MEMCHIP_map(uint8_t chip, uint32_t address, uint32_t size);
+
+#endif /* MEMORY_CHIP_IO_H__ */
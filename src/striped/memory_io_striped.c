@@ -0,0 +1,470 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * @file memory_io_striped.c
+ * @brief Striped NOR flash memory I/O over several chips.
+ *
+ * Implementation of the memory_io interface on top of several NOR flash chips
+ * (see memory_chip_io.h). The flat address space is interleaved across the
+ * chips one erase sector at a time, so consecutive file system blocks land on
+ * different chips and their programs and erases run in parallel.
+ *
+ * Build this file instead of the single-chip driver on boards with more than
+ * one chip. A program or erase request only waits for a chip when it needs it
+ * again; synchronous calls then wait for every chip they used.
+ */
+
+#include "memory_chip_io.h"
+#include "memory_io.h"
+#include <string.h>
+
+/* Chips used by the operation in progress, as a bit mask. */
+static uint32_t chips_in_use = 0;
+static uint32_t chips_suspended = 0;
+static MEMIO_Status_t striped_status = MEMIO_Status_Ok;
+
+static bool async_pending = false;
+static MEMIO_Status_t async_status = MEMIO_Status_Ok;
+static MEMIO_Callback_t async_callback = NULL;
+static void *async_context = NULL;
+
+static uint32_t striped_sector_size(void) {
+  MEMIO_Geometry_t geometry;
+  if (MEMCHIP_get_geometry(0, &geometry) != MEMIO_Status_Ok) {
+    return 0;
+  }
+  return geometry.sector_size;
+}
+
+static MEMIO_Status_t striped_locate(uint32_t address, uint32_t sector_size,
+                                     uint8_t *chip, uint32_t *chip_address) {
+  uint8_t count = MEMCHIP_get_count();
+  if (sector_size == 0 || count == 0) {
+    return MEMIO_Status_Err;
+  }
+
+  uint32_t stripe = address / sector_size;
+  *chip = (uint8_t)(stripe % count);
+  *chip_address = (stripe / count) * sector_size + address % sector_size;
+  return MEMIO_Status_Ok;
+}
+
+/* Wait for a chip before giving it more work, keeping its result. */
+static void striped_claim(uint8_t chip) {
+  uint32_t mask = 1UL << chip;
+  if ((chips_in_use & mask) != 0U) {
+    if (MEMCHIP_wait(chip) != MEMIO_Status_Ok) {
+      striped_status = MEMIO_Status_Err;
+    }
+  }
+  chips_in_use |= mask;
+}
+
+static MEMIO_Status_t striped_wait_all(void) {
+  uint8_t count = MEMCHIP_get_count();
+  for (uint8_t chip = 0; chip < count; chip++) {
+    if ((chips_in_use & (1UL << chip)) != 0U &&
+        MEMCHIP_wait(chip) != MEMIO_Status_Ok) {
+      striped_status = MEMIO_Status_Err;
+    }
+  }
+  chips_in_use = 0;
+
+  MEMIO_Status_t status = striped_status;
+  striped_status = MEMIO_Status_Ok;
+  return status;
+}
+
+static MEMIO_Status_t striped_start(void) {
+  if (MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  striped_status = MEMIO_Status_Ok;
+  return MEMIO_Status_Ok;
+}
+
+static MEMIO_Status_t striped_start_async(MEMIO_Callback_t callback,
+                                          void *context) {
+  async_pending = true;
+  async_callback = callback;
+  async_context = context;
+  return MEMIO_Status_Ok;
+}
+
+static void striped_complete_async(void) {
+  async_pending = false;
+  async_status = striped_wait_all();
+  if (async_callback != NULL) {
+    async_callback(async_status, async_context);
+  }
+}
+
+static MEMIO_Status_t striped_prog(uint32_t address, const void *buffer,
+                                   uint32_t size) {
+  MEMIO_Geometry_t geometry;
+  if (MEMCHIP_get_geometry(0, &geometry) != MEMIO_Status_Ok ||
+      geometry.page_size == 0) {
+    return MEMIO_Status_Err;
+  }
+
+  const uint8_t *data = buffer;
+  while (size > 0) {
+    uint32_t chunk = geometry.page_size - address % geometry.page_size;
+    if (chunk > size) {
+      chunk = size;
+    }
+
+    uint8_t chip;
+    uint32_t chip_address;
+    if (striped_locate(address, geometry.sector_size, &chip, &chip_address) !=
+        MEMIO_Status_Ok) {
+      return MEMIO_Status_Err;
+    }
+    striped_claim(chip);
+    if (MEMCHIP_prog(chip, chip_address, data, chunk) != MEMIO_Status_Ok) {
+      return MEMIO_Status_Err;
+    }
+
+    address += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  return MEMIO_Status_Ok;
+}
+
+static MEMIO_Status_t striped_erase_range(uint32_t address, uint32_t length) {
+  uint32_t sector_size = striped_sector_size();
+  uint8_t count = MEMCHIP_get_count();
+  if (sector_size == 0 || address % sector_size != 0 ||
+      length % sector_size != 0) {
+    return MEMIO_Status_Err;
+  }
+
+  /* Each chip owns every count-th sector of the range, and those sectors are
+   * consecutive in its own address space. */
+  uint32_t first_sector = address / sector_size;
+  uint32_t end_sector = first_sector + length / sector_size;
+  for (uint8_t chip = 0; chip < count; chip++) {
+    uint32_t first =
+        first_sector + (chip + count - first_sector % count) % count;
+    if (first >= end_sector) {
+      continue;
+    }
+    uint32_t sectors = (end_sector - first + count - 1U) / count;
+
+    striped_claim(chip);
+    if (MEMCHIP_erase_range(chip, (first / count) * sector_size,
+                            sectors * sector_size) != MEMIO_Status_Ok) {
+      return MEMIO_Status_Err;
+    }
+  }
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_get_geometry(MEMIO_Geometry_t *geometry) {
+  MEMIO_Status_t status = MEMCHIP_get_geometry(0, geometry);
+  if (status != MEMIO_Status_Ok) {
+    return status;
+  }
+
+  uint8_t count = MEMCHIP_get_count();
+  geometry->size *= count;
+  geometry->block_size *= count;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size) {
+  uint32_t sector_size = striped_sector_size();
+  if (sector_size == 0) {
+    return MEMIO_Status_Err;
+  }
+
+  uint8_t *data = buffer;
+  while (size > 0) {
+    uint32_t chunk = sector_size - address % sector_size;
+    if (chunk > size) {
+      chunk = size;
+    }
+
+    uint8_t chip;
+    uint32_t chip_address;
+    if (striped_locate(address, sector_size, &chip, &chip_address) !=
+            MEMIO_Status_Ok ||
+        MEMCHIP_read(chip, chip_address, data, chunk) != MEMIO_Status_Ok) {
+      return MEMIO_Status_Err;
+    }
+
+    address += chunk;
+    data += chunk;
+    size -= chunk;
+  }
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_readv(const MEMIO_Extent_t *extents, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    MEMIO_Status_t status =
+        MEMIO_read(extents[i].address, extents[i].buffer, extents[i].size);
+    if (status != MEMIO_Status_Ok) {
+      return status;
+    }
+  }
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_is_erased(uint32_t address, uint32_t size, bool *erased) {
+  uint8_t chunk[64];
+
+  while (size > 0) {
+    uint32_t chunk_size = (size < sizeof(chunk)) ? size : sizeof(chunk);
+    MEMIO_Status_t status = MEMIO_read(address, chunk, chunk_size);
+    if (status != MEMIO_Status_Ok) {
+      return status;
+    }
+
+    for (uint32_t i = 0; i < chunk_size; i++) {
+      if (chunk[i] != 0xFF) {
+        *erased = false;
+        return MEMIO_Status_Ok;
+      }
+    }
+
+    address += chunk_size;
+    size -= chunk_size;
+  }
+
+  *erased = true;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_crc32(uint32_t address, uint32_t size, uint32_t *crc) {
+  uint8_t chunk[64];
+  uint32_t value = *crc;
+
+  while (size > 0) {
+    uint32_t chunk_size = (size < sizeof(chunk)) ? size : sizeof(chunk);
+    MEMIO_Status_t status = MEMIO_read(address, chunk, chunk_size);
+    if (status != MEMIO_Status_Ok) {
+      return status;
+    }
+
+    for (uint32_t i = 0; i < chunk_size; i++) {
+      value ^= chunk[i];
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value >> 1) ^ ((value & 1U) ? 0xEDB88320U : 0U);
+      }
+    }
+
+    address += chunk_size;
+    size -= chunk_size;
+  }
+
+  *crc = value;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_compare(uint32_t address, const void *buffer,
+                             uint32_t size, int *result) {
+  const uint8_t *data = buffer;
+  uint8_t chunk[64];
+
+  *result = 0;
+  while (size > 0 && *result == 0) {
+    uint32_t chunk_size = (size < sizeof(chunk)) ? size : sizeof(chunk);
+    MEMIO_Status_t status = MEMIO_read(address, chunk, chunk_size);
+    if (status != MEMIO_Status_Ok) {
+      return status;
+    }
+
+    *result = memcmp(chunk, data, chunk_size);
+    address += chunk_size;
+    data += chunk_size;
+    size -= chunk_size;
+  }
+
+  return MEMIO_Status_Ok;
+}
+
+const void *MEMIO_map(uint32_t address, uint32_t size) {
+  uint32_t sector_size = striped_sector_size();
+  if (sector_size == 0 || address % sector_size + size > sector_size) {
+    return NULL;
+  }
+
+  uint8_t chip;
+  uint32_t chip_address;
+  if (striped_locate(address, sector_size, &chip, &chip_address) !=
+      MEMIO_Status_Ok) {
+    return NULL;
+  }
+  return MEMCHIP_map(chip, chip_address, size);
+}
+
+MEMIO_Status_t MEMIO_prog(uint32_t address, const void *buffer, uint32_t size) {
+  MEMIO_Status_t status = striped_start();
+  if (status != MEMIO_Status_Ok) {
+    return status;
+  }
+  status = striped_prog(address, buffer, size);
+  if (striped_wait_all() != MEMIO_Status_Ok) {
+    status = MEMIO_Status_Err;
+  }
+  return status;
+}
+
+MEMIO_Status_t MEMIO_progv(const MEMIO_Extent_t *extents, uint32_t count) {
+  MEMIO_Status_t status = striped_start();
+  for (uint32_t i = 0; i < count && status == MEMIO_Status_Ok; i++) {
+    status = striped_prog(extents[i].address, extents[i].buffer,
+                          extents[i].size);
+  }
+  if (striped_wait_all() != MEMIO_Status_Ok) {
+    status = MEMIO_Status_Err;
+  }
+  return status;
+}
+
+MEMIO_Status_t MEMIO_erase(uint32_t address) {
+  uint32_t sector_size = striped_sector_size();
+  if (sector_size == 0) {
+    return MEMIO_Status_Err;
+  }
+  return MEMIO_erase_range(address - address % sector_size, sector_size);
+}
+
+MEMIO_Status_t MEMIO_erase_range(uint32_t address, uint32_t length) {
+  MEMIO_Status_t status = striped_start();
+  if (status != MEMIO_Status_Ok) {
+    return status;
+  }
+  status = striped_erase_range(address, length);
+  if (striped_wait_all() != MEMIO_Status_Ok) {
+    status = MEMIO_Status_Err;
+  }
+  return status;
+}
+
+MEMIO_Status_t MEMIO_prog_async(uint32_t address, const void *buffer,
+                                uint32_t size, MEMIO_Callback_t callback,
+                                void *context) {
+  MEMIO_Status_t status = striped_start();
+  if (status == MEMIO_Status_Ok) {
+    status = striped_prog(address, buffer, size);
+  }
+  if (status != MEMIO_Status_Ok) {
+    striped_wait_all();
+    return status;
+  }
+  return striped_start_async(callback, context);
+}
+
+MEMIO_Status_t MEMIO_progv_async(const MEMIO_Extent_t *extents, uint32_t count,
+                                 MEMIO_Callback_t callback, void *context) {
+  MEMIO_Status_t status = striped_start();
+  for (uint32_t i = 0; i < count && status == MEMIO_Status_Ok; i++) {
+    status = striped_prog(extents[i].address, extents[i].buffer,
+                          extents[i].size);
+  }
+  if (status != MEMIO_Status_Ok) {
+    striped_wait_all();
+    return status;
+  }
+  return striped_start_async(callback, context);
+}
+
+MEMIO_Status_t MEMIO_erase_async(uint32_t address, MEMIO_Callback_t callback,
+                                 void *context) {
+  uint32_t sector_size = striped_sector_size();
+  if (sector_size == 0) {
+    return MEMIO_Status_Err;
+  }
+  return MEMIO_erase_range_async(address - address % sector_size, sector_size,
+                                 callback, context);
+}
+
+MEMIO_Status_t MEMIO_erase_range_async(uint32_t address, uint32_t length,
+                                       MEMIO_Callback_t callback,
+                                       void *context) {
+  MEMIO_Status_t status = striped_start();
+  if (status == MEMIO_Status_Ok) {
+    status = striped_erase_range(address, length);
+  }
+  if (status != MEMIO_Status_Ok) {
+    striped_wait_all();
+    return status;
+  }
+  return striped_start_async(callback, context);
+}
+
+bool MEMIO_is_busy(void) {
+  uint8_t count = MEMCHIP_get_count();
+  for (uint8_t chip = 0; chip < count; chip++) {
+    if (MEMCHIP_is_busy(chip)) {
+      return true;
+    }
+  }
+
+  if (async_pending) {
+    striped_complete_async();
+  }
+  return false;
+}
+
+MEMIO_Status_t MEMIO_wait(void) {
+  if (chips_suspended != 0U) {
+    return MEMIO_Status_Err;
+  }
+
+  if (async_pending) {
+    striped_complete_async();
+  }
+  return async_status;
+}
+
+MEMIO_Status_t MEMIO_suspend(void) {
+  uint8_t count = MEMCHIP_get_count();
+  for (uint8_t chip = 0; chip < count; chip++) {
+    if ((chips_suspended & (1UL << chip)) == 0U &&
+        MEMCHIP_suspend(chip) == MEMIO_Status_Ok) {
+      chips_suspended |= 1UL << chip;
+    }
+  }
+  return (chips_suspended != 0U) ? MEMIO_Status_Ok : MEMIO_Status_Err;
+}
+
+MEMIO_Status_t MEMIO_resume(void) {
+  if (chips_suspended == 0U) {
+    return MEMIO_Status_Err;
+  }
+
+  uint8_t count = MEMCHIP_get_count();
+  for (uint8_t chip = 0; chip < count; chip++) {
+    if ((chips_suspended & (1UL << chip)) != 0U) {
+      MEMCHIP_resume(chip);
+    }
+  }
+  chips_suspended = 0;
+  return MEMIO_Status_Ok;
+}
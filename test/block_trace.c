@@ -0,0 +1,218 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "block_trace.h"
+#include "lfs/lfs_util.h"
+#include "memory_io.h"
+#include <string.h>
+#include <time.h>
+
+#define BLOCK_TRACE_MAGIC "FSTRACE2"
+#define BLOCK_TRACE_MAGIC_SIZE 8U
+#define BLOCK_TRACE_HASHED 0x80U
+#define BLOCK_TRACE_PAYLOAD 0x40U
+#define BLOCK_TRACE_RECORD_SIZE_MAX 21U
+#define BLOCK_TRACE_CHUNK_SIZE 4096U
+
+static FILE *trace_stream = NULL;
+static uint64_t (*trace_clock_ns)(void) = NULL;
+static bool trace_hash_payloads = false;
+static bool trace_write_failed = false;
+
+static uint8_t trace_chunk[BLOCK_TRACE_CHUNK_SIZE];
+
+static uint64_t trace_monotonic_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000U + (uint64_t)now.tv_nsec;
+}
+
+static uint8_t *trace_put(uint8_t *record, uint64_t value, unsigned bytes) {
+  for (unsigned i = 0U; i < bytes; i++) {
+    record[i] = (uint8_t)(value >> (8U * i));
+  }
+  return record + bytes;
+}
+
+static uint64_t trace_get(const uint8_t *record, unsigned bytes) {
+  uint64_t value = 0U;
+  for (unsigned i = 0U; i < bytes; i++) {
+    value |= (uint64_t)record[i] << (8U * i);
+  }
+  return value;
+}
+
+static void trace_write(FS_Trace_Op_t op, uint32_t address, uint32_t size,
+                        const void *data, void *context) {
+  uint8_t record[BLOCK_TRACE_RECORD_SIZE_MAX];
+  bool hashed = trace_hash_payloads && data != NULL;
+  bool payload = op == FS_Trace_Prog && data != NULL;
+  uint8_t *end = record;
+
+  *end++ = (uint8_t)op | (hashed ? BLOCK_TRACE_HASHED : 0U) |
+           (payload ? BLOCK_TRACE_PAYLOAD : 0U);
+  end = trace_put(end, address, 4U);
+  end = trace_put(end, size, 4U);
+  if (hashed) {
+    end = trace_put(end, lfs_crc(0xFFFFFFFFU, data, size), 4U);
+  }
+  end = trace_put(end, trace_clock_ns(), 8U);
+
+  size_t length = (size_t)(end - record);
+  if (fwrite(record, 1U, length, trace_stream) != length ||
+      (payload && fwrite(data, 1U, size, trace_stream) != size)) {
+    trace_write_failed = true;
+  }
+}
+
+bool BLOCK_TRACE_record(FILE *stream, uint64_t (*clock_ns)(void),
+                        bool hash_payloads) {
+  if (stream == NULL || fwrite(BLOCK_TRACE_MAGIC, 1U, BLOCK_TRACE_MAGIC_SIZE,
+                               stream) != BLOCK_TRACE_MAGIC_SIZE) {
+    return false;
+  }
+
+  trace_stream = stream;
+  trace_clock_ns = (clock_ns != NULL) ? clock_ns : trace_monotonic_ns;
+  trace_hash_payloads = hash_payloads;
+  trace_write_failed = false;
+  FS_set_trace(trace_write, NULL);
+
+  return true;
+}
+
+bool BLOCK_TRACE_stop(void) {
+  FS_set_trace(NULL, NULL);
+  if (trace_stream == NULL) {
+    return false;
+  }
+
+  bool ok = !trace_write_failed && fflush(trace_stream) == 0;
+  trace_stream = NULL;
+
+  return ok;
+}
+
+/* Splits the transfer so any size can be replayed through the scratch
+ * buffer. A program takes its data from the stream when it was recorded, and
+ * writes zeros otherwise. Returns false only if the stream is truncated; a
+ * transfer the memory rejects is counted in failures. */
+static bool replay_transfer(FILE *stream, FS_Trace_Op_t op, uint32_t address,
+                            uint32_t size, bool payload, uint32_t *failures) {
+  bool rejected = false;
+
+  if (op == FS_Trace_Prog && !payload) {
+    memset(trace_chunk, 0, sizeof(trace_chunk));
+  }
+  while (size > 0U) {
+    uint32_t chunk = (size < BLOCK_TRACE_CHUNK_SIZE) ? size
+                                                     : BLOCK_TRACE_CHUNK_SIZE;
+    if (payload && fread(trace_chunk, 1U, chunk, stream) != chunk) {
+      return false;
+    }
+    MEMIO_Status_t status = (op == FS_Trace_Read)
+                                ? MEMIO_read(address, trace_chunk, chunk)
+                                : MEMIO_prog(address, trace_chunk, chunk);
+    if (status != MEMIO_Status_Ok) {
+      rejected = true;
+    }
+    address += chunk;
+    size -= chunk;
+  }
+  if (rejected) {
+    (*failures)++;
+  }
+  return true;
+}
+
+bool BLOCK_TRACE_replay(FILE *stream, BLOCK_TRACE_Replay_Result_t *result) {
+  char magic[BLOCK_TRACE_MAGIC_SIZE];
+  uint8_t record[BLOCK_TRACE_RECORD_SIZE_MAX];
+  uint64_t first_ns = 0U;
+  bool first = true;
+
+  if (stream == NULL || result == NULL) {
+    return false;
+  }
+  memset(result, 0, sizeof(*result));
+
+  if (fread(magic, 1U, sizeof(magic), stream) != sizeof(magic) ||
+      memcmp(magic, BLOCK_TRACE_MAGIC, sizeof(magic)) != 0) {
+    return false;
+  }
+
+  while (fread(record, 1U, 1U, stream) == 1U) {
+    FS_Trace_Op_t op = (FS_Trace_Op_t)(record[0] & ~(BLOCK_TRACE_HASHED |
+                                                     BLOCK_TRACE_PAYLOAD));
+    bool payload = (record[0] & BLOCK_TRACE_PAYLOAD) != 0U;
+    size_t length = (record[0] & BLOCK_TRACE_HASHED) ? 20U : 16U;
+    if (op > FS_Trace_Sync || (payload && op != FS_Trace_Prog) ||
+        fread(&record[1], 1U, length, stream) != length) {
+      return false;
+    }
+
+    uint32_t address = (uint32_t)trace_get(&record[1], 4U);
+    uint32_t size = (uint32_t)trace_get(&record[5], 4U);
+    uint64_t timestamp_ns = trace_get(&record[1 + length - 8U], 8U);
+    if (first) {
+      first_ns = timestamp_ns;
+      first = false;
+    }
+    result->recorded_ns = timestamp_ns - first_ns;
+
+    bool ok = true;
+    switch (op) {
+    case FS_Trace_Read:
+      result->reads++;
+      result->bytes_read += size;
+      if (!replay_transfer(stream, op, address, size, false,
+                           &result->failures)) {
+        return false;
+      }
+      break;
+    case FS_Trace_Prog:
+      result->progs++;
+      result->bytes_programmed += size;
+      if (!replay_transfer(stream, op, address, size, payload,
+                           &result->failures)) {
+        return false;
+      }
+      break;
+    case FS_Trace_Erase:
+      result->erases++;
+      ok = MEMIO_erase_range(address, size) == MEMIO_Status_Ok;
+      break;
+    case FS_Trace_Sync:
+    default:
+      result->syncs++;
+      ok = MEMIO_wait() == MEMIO_Status_Ok;
+      break;
+    }
+    if (!ok) {
+      result->failures++;
+    }
+  }
+
+  return feof(stream) != 0;
+}
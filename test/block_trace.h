@@ -0,0 +1,85 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+#ifndef BLOCK_TRACE_H__
+#define BLOCK_TRACE_H__
+
+#include "file_system.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * @brief Totals of a trace replayed against the fake memory.
+ */
+typedef struct {
+  uint32_t reads;
+  uint32_t progs;
+  uint32_t erases;
+  uint32_t syncs;
+  uint64_t bytes_read;
+  uint64_t bytes_programmed;
+  uint64_t recorded_ns; /**< Time between the first and the last record */
+  uint32_t failures;    /**< Operations the memory rejected */
+} BLOCK_TRACE_Replay_Result_t;
+
+/**
+ * @brief Start recording the block device operations of the file system.
+ *
+ * The stream receives a header, then one little-endian record per operation:
+ * the FS_Trace_Op_t in the low bits of a byte whose top bit tells whether a
+ * payload hash follows and whose next bit tells whether the data follows, the
+ * address and size as 32-bit words, the optional CRC-32 of the data read or
+ * programmed, a 64-bit timestamp and, for programs, the data itself.
+ *
+ * @param stream Binary stream to write the trace to.
+ * @param clock_ns Timestamp source, NULL for the host monotonic clock.
+ * @param hash_payloads Whether to record the hash of the data.
+ * @return true if recording started, false if the header could not be written.
+ */
+bool BLOCK_TRACE_record(FILE *stream, uint64_t (*clock_ns)(void),
+                        bool hash_payloads);
+
+/**
+ * @brief Stop recording and flush the stream.
+ *
+ * @return true if every record was written, false otherwise.
+ */
+bool BLOCK_TRACE_stop(void);
+
+/**
+ * @brief Issue the operations of a trace to the fake memory.
+ *
+ * Operations are replayed as recorded, through MEMIO_read(), MEMIO_prog(),
+ * MEMIO_erase_range() and MEMIO_wait(), so programs write the recorded data
+ * and the memory ends with the contents it had when recording. Select the
+ * timing model and geometry of the fake beforehand to see how they affect the
+ * same workload.
+ *
+ * @param stream Binary stream positioned at the start of a trace.
+ * @param result Pointer where the totals will be stored.
+ * @return true if the whole trace was replayed, false if it is malformed.
+ */
+bool BLOCK_TRACE_replay(FILE *stream, BLOCK_TRACE_Replay_Result_t *result);
+
+#endif /* BLOCK_TRACE_H__ */
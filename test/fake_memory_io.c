@@ -23,27 +23,1153 @@
  */
 
 #include "fake_memory_io.h"
+#include <fcntl.h>
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-static uint8_t *fake_buffer = NULL;
-void FAKE_MEMORY_IO_set_buffer(uint8_t *buffer) { fake_buffer = buffer; }
+/* GD25Q16C: 2 MiB, 256-byte pages, 4 KiB sectors and 32/64 KiB blocks. */
+static const MEMIO_Geometry_t fake_default_geometry = {
+    .jedec_id = 0xC84015,
+    .size = 2U * 1024U * 1024U,
+    .page_size = 256U,
+    .sector_size = 4096U,
+    .block_size = 64U * 1024U,
+};
 
-MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size) {
+/* Approximate typical GD25Q16C figures. Fast Read runs at 120 MHz on a single
+ * line: 8 clocks per byte, 40 for the opcode, address and dummy byte. */
+static const FAKE_MEMORY_IO_Timing_t fake_default_timing = {
+    .command_ns = 350U,
+    .byte_ns = 67U,
+    .page_prog_us = 600U,
+    .sector_erase_us = 50000U,
+    .half_block_erase_us = 150000U,
+    .block_erase_us = 250000U,
+    .chip_erase_us = 15000000U,
+    .suspend_us = 20U,
+    .resume_us = 0U,
+};
+
+/* Tables for the slice-by-4 CRC-32 used by littlefs, shared by all devices. */
+static uint32_t fake_crc_table[4][256];
+static pthread_once_t fake_crc_table_once = PTHREAD_ONCE_INIT;
+
+/* Operations that have to see the errors of the model go through a copy of
+ * the memory, in chunks of this size. */
+#define FAKE_VIEW_CHUNK_SIZE 256U
+
+typedef enum {
+  FAKE_FLIP_ANY,
+  FAKE_FLIP_ZEROS, /* Programmed bits read erased */
+  FAKE_FLIP_ONES,  /* Erased bits read programmed */
+} FAKE_Flip_t;
+
+/* Device used by threads that have not selected one. */
+static FAKE_MEMORY_IO_Device_t fake_default_device;
+static _Thread_local FAKE_MEMORY_IO_Device_t *fake_selected_device = NULL;
+
+static FAKE_MEMORY_IO_Device_t *fake_device(void) {
+  return (fake_selected_device != NULL) ? fake_selected_device
+                                        : &fake_default_device;
+}
+
+void FAKE_MEMORY_IO_select(FAKE_MEMORY_IO_Device_t *device) {
+  fake_selected_device = device;
+}
+
+FAKE_MEMORY_IO_Device_t *FAKE_MEMORY_IO_selected(void) { return fake_device(); }
+
+static void fake_reset(uint8_t *buffer) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->buffer = buffer;
+  fake->geometry = fake_default_geometry;
+  fake->suspended = false;
+  fake->async_pending = false;
+  fake->async_status = MEMIO_Status_Ok;
+  fake->timing = fake_default_timing;
+  fake->clock_ns = 0;
+  fake->clock_ready_ns = 0;
+  fake->cut_armed = false;
+  fake->cut_commands = 0;
+  fake->powered_off = false;
+  fake->snapshot = NULL;
+  fake->errors_enabled = false;
+  fake->stuck_bit_count = 0;
+  memset(fake->sector_aged_ns, 0, sizeof(fake->sector_aged_ns));
+  FAKE_MEMORY_IO_reset_stats();
+  FAKE_MEMORY_IO_reset_wear();
+}
+
+void FAKE_MEMORY_IO_set_buffer(uint8_t *buffer) {
+  FAKE_MEMORY_IO_unmap_image();
+  fake_reset(buffer);
+}
+
+/* Maps the image file as the memory, so large images load without being
+ * copied. A size of 0 takes the size of the file. In shared mode the file is
+ * created or grown to size as needed, and the new space reads as erased. */
+bool FAKE_MEMORY_IO_map_image(const char *path, uint32_t size,
+                              FAKE_MEMORY_IO_Image_Mode_t mode) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  FAKE_MEMORY_IO_unmap_image();
+
+  bool shared = (mode == FAKE_MEMORY_IO_Image_Shared);
+  int fd = open(path, shared ? (O_RDWR | O_CREAT) : O_RDONLY, 0644);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    return false;
+  }
+
+  size_t file_size = (size_t)info.st_size;
+  size_t image_size = (size == 0U) ? file_size : size;
+  if (image_size == 0U || (!shared && image_size > file_size) ||
+      (shared && image_size > file_size &&
+       ftruncate(fd, (off_t)image_size) != 0)) {
+    close(fd);
+    return false;
+  }
+
+  void *image = mmap(NULL, image_size, PROT_READ | PROT_WRITE,
+                     shared ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (image == MAP_FAILED) {
+    return false;
+  }
+
+  if (image_size > file_size) {
+    memset((uint8_t *)image + file_size, 0xFF, image_size - file_size);
+  }
+
+  fake_reset(image);
+  fake->image = image;
+  fake->image_size = image_size;
+  fake->geometry.size = (uint32_t)image_size;
+  return true;
+}
+
+void FAKE_MEMORY_IO_unmap_image(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->image == NULL) {
+    return;
+  }
+
+  munmap(fake->image, fake->image_size);
+  if (fake->buffer == fake->image) {
+    fake->buffer = NULL;
+  }
+  fake->image = NULL;
+  fake->image_size = 0;
+}
+
+void FAKE_MEMORY_IO_set_geometry(const MEMIO_Geometry_t *geometry) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->geometry = *geometry;
+}
+
+/* Gives every page program, and every erase command whatever its size, the
+ * same busy time. */
+void FAKE_MEMORY_IO_set_busy_time(uint32_t prog_us, uint32_t erase_us) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->timing.page_prog_us = prog_us;
+  fake->timing.sector_erase_us = erase_us;
+  fake->timing.half_block_erase_us = erase_us;
+  fake->timing.block_erase_us = erase_us;
+  fake->timing.chip_erase_us = erase_us;
+}
+
+void FAKE_MEMORY_IO_set_suspend_time(uint32_t suspend_us, uint32_t resume_us) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->timing.suspend_us = suspend_us;
+  fake->timing.resume_us = resume_us;
+}
+
+void FAKE_MEMORY_IO_set_timing(const FAKE_MEMORY_IO_Timing_t *timing) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->timing = *timing;
+}
+
+void FAKE_MEMORY_IO_get_timing(FAKE_MEMORY_IO_Timing_t *timing) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  *timing = fake->timing;
+}
+
+uint64_t FAKE_MEMORY_IO_get_virtual_time_ns(void) {
+  return fake_device()->clock_ns;
+}
+
+/* Lets time pass without commands, e.g. to age the data the device retains or
+ * to let the operation in progress complete. */
+void FAKE_MEMORY_IO_advance_virtual_time(uint64_t ns) {
+  fake_device()->clock_ns += ns;
+}
+
+static uint32_t fake_wear_sectors(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t sectors = (fake->geometry.sector_size == 0U)
+                         ? 0U
+                         : fake->geometry.size / fake->geometry.sector_size;
+  return (sectors < FAKE_MEMORY_IO_SECTORS_MAX)
+             ? sectors
+             : FAKE_MEMORY_IO_SECTORS_MAX;
+}
+
+static void fake_wear_erase(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t first = address / fake->geometry.sector_size;
+  uint32_t last = (address + size) / fake->geometry.sector_size;
+  for (uint32_t sector = first;
+       sector < last && sector < FAKE_MEMORY_IO_SECTORS_MAX; sector++) {
+    fake->sector_erases[sector]++;
+    fake->sector_aged_ns[sector] = fake->clock_ns;
+  }
+}
+
+static void fake_wear_prog(uint32_t address) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t sector = address / fake->geometry.sector_size;
+  if (sector < FAKE_MEMORY_IO_SECTORS_MAX) {
+    fake->sector_progs[sector]++;
+  }
+}
+
+void FAKE_MEMORY_IO_get_wear(uint32_t sector, FAKE_MEMORY_IO_Wear_t *wear) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (sector >= fake_wear_sectors()) {
+    memset(wear, 0, sizeof(*wear));
+    return;
+  }
+  wear->erases = fake->sector_erases[sector];
+  wear->programs = fake->sector_progs[sector];
+}
+
+/* Endurance is given in erase cycles per sector. The counters are taken as
+ * the wear caused by one run of the workload, so the lifetime is how many
+ * more runs the most worn sector can take. */
+void FAKE_MEMORY_IO_get_wear_report(uint32_t endurance_cycles,
+                                    FAKE_MEMORY_IO_Wear_Report_t *report) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t sectors = fake_wear_sectors();
+  memset(report, 0, sizeof(*report));
+  report->sectors = sectors;
+  if (sectors == 0U) {
+    return;
+  }
+
+  double sum = 0.0;
+  double sum_squares = 0.0;
+  report->min_erases = UINT32_MAX;
+  for (uint32_t i = 0; i < sectors; i++) {
+    uint32_t erases = fake->sector_erases[i];
+    if (erases < report->min_erases) {
+      report->min_erases = erases;
+    }
+    if (erases > report->max_erases) {
+      report->max_erases = erases;
+    }
+    sum += erases;
+    sum_squares += (double)erases * erases;
+  }
+  report->mean_erases = sum / sectors;
+  double variance = sum_squares / sectors -
+                    report->mean_erases * report->mean_erases;
+  report->stddev_erases = (variance > 0.0) ? sqrt(variance) : 0.0;
+
+  report->histogram_bin_width =
+      report->max_erases / FAKE_MEMORY_IO_WEAR_HISTOGRAM_BINS + 1U;
+  for (uint32_t i = 0; i < sectors; i++) {
+    report->histogram[fake->sector_erases[i] / report->histogram_bin_width]++;
+  }
+
+  if (report->max_erases > 0U) {
+    report->projected_runs = (double)endurance_cycles / report->max_erases;
+  }
+}
+
+void FAKE_MEMORY_IO_print_wear_report(
+    FILE *stream, const FAKE_MEMORY_IO_Wear_Report_t *report) {
+  fprintf(stream, "sectors: %u\n", (unsigned)report->sectors);
+  fprintf(stream, "erases: min %u, max %u, mean %.2f, stddev %.2f\n",
+          (unsigned)report->min_erases, (unsigned)report->max_erases,
+          report->mean_erases, report->stddev_erases);
+  for (uint32_t i = 0; i < FAKE_MEMORY_IO_WEAR_HISTOGRAM_BINS; i++) {
+    uint32_t low = i * report->histogram_bin_width;
+    fprintf(stream, "  %6u-%-6u: %u\n", (unsigned)low,
+            (unsigned)(low + report->histogram_bin_width - 1U),
+            (unsigned)report->histogram[i]);
+  }
+  if (report->projected_runs > 0.0) {
+    fprintf(stream, "projected lifetime: %.0f workload runs\n",
+            report->projected_runs);
+  }
+}
+
+void FAKE_MEMORY_IO_reset_wear(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  memset(fake->sector_erases, 0, sizeof(fake->sector_erases));
+  memset(fake->sector_progs, 0, sizeof(fake->sector_progs));
+}
+
+void FAKE_MEMORY_IO_set_power_cut(uint32_t commands,
+                                  FAKE_MEMORY_IO_Cut_Mode_t mode) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->cut_armed = true;
+  fake->cut_after = commands;
+  fake->cut_commands = 0;
+  fake->cut_mode = mode;
+}
+
+/* Power comes back as after a cold boot: idle, with nothing pending. */
+void FAKE_MEMORY_IO_restore_power(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->cut_armed = false;
+  fake->powered_off = false;
+  fake->suspended = false;
+  fake->async_pending = false;
+  fake->async_status = MEMIO_Status_Ok;
+  fake->clock_ready_ns = fake->clock_ns;
+}
+
+/* Writes that bypass the fake, like filling the buffer directly, are not
+ * tracked: take a new snapshot after them. The storage must be as large as
+ * the device and stay valid until the buffer is replaced. */
+bool FAKE_MEMORY_IO_take_snapshot(uint8_t *storage) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->geometry.sector_size == 0U ||
+      fake->geometry.size / fake->geometry.sector_size >
+          FAKE_MEMORY_IO_SECTORS_MAX) {
+    return false;
+  }
+
+  fake->snapshot = storage;
+  memset(fake->snapshot_dirty, 0, sizeof(fake->snapshot_dirty));
+  return true;
+}
+
+uint32_t FAKE_MEMORY_IO_restore_snapshot(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->snapshot == NULL) {
+    return 0;
+  }
+
+  uint32_t sector_size = fake->geometry.sector_size;
+  uint32_t sectors = fake->geometry.size / sector_size;
+  uint32_t restored = 0;
+  for (uint32_t sector = 0; sector < sectors; sector++) {
+    uint8_t mask = (uint8_t)(1U << (sector % 8U));
+    if ((fake->snapshot_dirty[sector / 8U] & mask) != 0U) {
+      memcpy(&fake->buffer[sector * sector_size],
+             &fake->snapshot[sector * sector_size], sector_size);
+      fake->snapshot_dirty[sector / 8U] &= (uint8_t)~mask;
+      restored++;
+    }
+  }
+  return restored;
+}
+
+static void fake_snapshot_touch(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->snapshot == NULL || size == 0U) {
+    return;
+  }
+
+  uint32_t sector_size = fake->geometry.sector_size;
+  for (uint32_t sector = address / sector_size;
+       sector <= (address + size - 1U) / sector_size; sector++) {
+    uint8_t mask = (uint8_t)(1U << (sector % 8U));
+    if ((fake->snapshot_dirty[sector / 8U] & mask) == 0U) {
+      memcpy(&fake->snapshot[sector * sector_size],
+             &fake->buffer[sector * sector_size], sector_size);
+      fake->snapshot_dirty[sector / 8U] |= mask;
+    }
+  }
+}
+
+/* Retention is counted from the time the errors are set, for sectors that are
+ * not erased since. Stuck bits are kept until the errors are cleared. */
+void FAKE_MEMORY_IO_set_errors(const FAKE_MEMORY_IO_Errors_t *errors) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->errors = *errors;
+  fake->errors_enabled = true;
+  fake->error_random =
+      (errors->seed != 0U) ? errors->seed : 0x9E3779B97F4A7C15U;
+  for (uint32_t sector = 0; sector < FAKE_MEMORY_IO_SECTORS_MAX; sector++) {
+    fake->sector_aged_ns[sector] = fake->clock_ns;
+  }
+}
+
+bool FAKE_MEMORY_IO_add_stuck_bit(uint32_t address, uint8_t bit, bool value) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->stuck_bit_count == FAKE_MEMORY_IO_STUCK_BITS_MAX || bit > 7U ||
+      address >= fake->geometry.size) {
+    return false;
+  }
+
+  FAKE_MEMORY_IO_Stuck_Bit_t *stuck = &fake->stuck_bits[fake->stuck_bit_count];
+  stuck->address = address;
+  stuck->bit = bit;
+  stuck->value = value;
+  fake->stuck_bit_count++;
+  return true;
+}
+
+void FAKE_MEMORY_IO_clear_errors(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->errors_enabled = false;
+  fake->stuck_bit_count = 0;
+}
+
+/* xorshift64*, uniform in (0, 1]. */
+static double fake_random(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint64_t x = fake->error_random;
+  x ^= x >> 12;
+  x ^= x << 25;
+  x ^= x >> 27;
+  fake->error_random = x;
+  return (double)(((x * 0x2545F4914F6CDD1DU) >> 11) + 1U) * 0x1.0p-53;
+}
+
+/* Bits to skip until the next one hit with probability p, so sparse errors
+ * cost one draw each instead of one per bit. */
+static uint64_t fake_random_skip(double p) {
+  if (p <= 0.0) {
+    return UINT64_MAX;
+  }
+  if (p >= 1.0) {
+    return 0;
+  }
+  double skip = log(fake_random()) / log1p(-p);
+  return (skip < 1.8e19) ? (uint64_t)skip : UINT64_MAX;
+}
+
+/* Flips bits of data with probability p. When the data is the memory itself,
+ * at the given address, the snapshot keeps the sectors being changed. */
+static void fake_flip_bits(uint8_t *data, uint32_t address, uint32_t size,
+                           double p, FAKE_Flip_t mode) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  bool in_memory = (data == &fake->buffer[address]);
+  uint64_t bits = (uint64_t)size * 8U;
+  uint64_t bit = 0;
+
+  for (;;) {
+    uint64_t skip = fake_random_skip(p);
+    if (skip >= bits - bit) {
+      break;
+    }
+    bit += skip;
+
+    uint8_t mask = (uint8_t)(1U << (bit % 8U));
+    bool set = (data[bit / 8U] & mask) != 0U;
+    if (mode == FAKE_FLIP_ANY || (mode == FAKE_FLIP_ZEROS && !set) ||
+        (mode == FAKE_FLIP_ONES && set)) {
+      if (in_memory) {
+        fake_snapshot_touch(address + (uint32_t)(bit / 8U), 1U);
+      }
+      data[bit / 8U] ^= mask;
+      fake->stats.bit_flips++;
+    }
+    bit++;
+  }
+}
+
+/* Applies the retention loss and the read disturb of the sectors being read
+ * to the memory. */
+static void fake_decay(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake->errors_enabled || size == 0U) {
+    return;
+  }
+
+  uint32_t sector_size = fake->geometry.sector_size;
+  for (uint32_t sector = address / sector_size;
+       sector <= (address + size - 1U) / sector_size; sector++) {
+    uint32_t start = sector * sector_size;
+    if (sector < FAKE_MEMORY_IO_SECTORS_MAX) {
+      double seconds =
+          (double)(fake->clock_ns - fake->sector_aged_ns[sector]) / 1e9;
+      fake->sector_aged_ns[sector] = fake->clock_ns;
+      fake_flip_bits(&fake->buffer[start], start, sector_size,
+                     fake->errors.retention_rate * seconds, FAKE_FLIP_ZEROS);
+    }
+    fake_flip_bits(&fake->buffer[start], start, sector_size,
+                   fake->errors.read_disturb_rate, FAKE_FLIP_ONES);
+  }
+}
+
+static bool fake_corrupts_reads(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  return (fake->errors_enabled && fake->errors.read_bit_error_rate > 0.0) ||
+         fake->stuck_bit_count > 0U;
+}
+
+/* Turns data read from the memory at the given address into what the host
+ * receives, with transient errors and stuck bits. */
+static void fake_corrupt(uint32_t address, uint8_t *data, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->errors_enabled) {
+    fake_flip_bits(data, UINT32_MAX, size, fake->errors.read_bit_error_rate,
+                   FAKE_FLIP_ANY);
+  }
+  for (uint32_t i = 0; i < fake->stuck_bit_count; i++) {
+    const FAKE_MEMORY_IO_Stuck_Bit_t *stuck = &fake->stuck_bits[i];
+    if (stuck->address >= address && stuck->address - address < size) {
+      uint8_t mask = (uint8_t)(1U << stuck->bit);
+      uint8_t *byte = &data[stuck->address - address];
+      *byte = stuck->value ? (uint8_t)(*byte | mask) : (uint8_t)(*byte & ~mask);
+    }
+  }
+}
+
+/* Data of the memory as the host would read it. Without errors to apply it
+ * is used in place, otherwise the next chunk is copied and corrupted. Returns
+ * the size available at *data. */
+static uint32_t fake_view(uint32_t address, uint32_t size, uint8_t *chunk,
+                          const uint8_t **data) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_corrupts_reads()) {
+    *data = &fake->buffer[address];
+    return size;
+  }
+
+  if (size > FAKE_VIEW_CHUNK_SIZE) {
+    size = FAKE_VIEW_CHUNK_SIZE;
+  }
+  memcpy(chunk, &fake->buffer[address], size);
+  fake_corrupt(address, chunk, size);
+  *data = chunk;
+  return size;
+}
+
+/* A marginal cell that fails to program while the command still completes:
+ * the first bit to clear from a random offset of the page stays erased. */
+static void fake_prog_fail(uint32_t address, const uint8_t *data,
+                           uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t offset = (uint32_t)(fake_random() * size) % size;
   for (uint32_t i = 0; i < size; i++) {
-    ((uint8_t *)buffer)[i] = fake_buffer[address + i];
+    uint32_t at = (offset + i) % size;
+    uint8_t cleared = (uint8_t)~data[at];
+    if (cleared != 0U) {
+      fake->buffer[address + at] |= (uint8_t)(cleared & -cleared);
+      fake->stats.bit_flips++;
+      return;
+    }
   }
+}
+
+void FAKE_MEMORY_IO_get_stats(FAKE_MEMORY_IO_Stats_t *stats) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  *stats = fake->stats;
+}
+
+void FAKE_MEMORY_IO_reset_stats(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  memset(&fake->stats, 0, sizeof(fake->stats));
+}
+
+/* Records the memory the operation just issued works on. */
+static void fake_start_busy(uint32_t start, uint32_t end) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->busy_start = start;
+  fake->busy_end = end;
+}
+
+/* Waiting for the device moves the clock to the end of its busy time. */
+static void fake_clock_sync(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake->suspended && fake->clock_ns < fake->clock_ready_ns) {
+    fake->stats.host_wait_us += (fake->clock_ready_ns - fake->clock_ns) / 1000U;
+    fake->clock_ns = fake->clock_ready_ns;
+  }
+}
+
+/* Bus time of one command moving size bytes. The device has to be ready
+ * unless the operation in progress is suspended. */
+static void fake_clock_command(uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake_clock_sync();
+  fake->clock_ns +=
+      fake->timing.command_ns + (uint64_t)size * fake->timing.byte_ns;
+}
+
+static void fake_clock_busy(uint32_t busy_us) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->clock_ready_ns = fake->clock_ns + (uint64_t)busy_us * 1000U;
+  fake->stats.device_busy_us += busy_us;
+}
+
+/* The device only accepts commands while powered and inside its size. */
+static bool fake_accepts(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  return !fake->powered_off && address <= fake->geometry.size &&
+         size <= fake->geometry.size - address;
+}
+
+static bool fake_accepts_extents(const MEMIO_Extent_t *extents,
+                                   uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (!fake_accepts(extents[i].address, extents[i].size)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Counts a page program or erase command and tells whether power is lost
+ * while it runs. */
+static bool fake_power_cut(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->cut_commands++ != fake->cut_after || !fake->cut_armed) {
+    return false;
+  }
+  fake->powered_off = true;
+  return true;
+}
+
+static bool fake_read_blocked(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, size)) {
+    return true;
+  }
+  if (fake->suspended) {
+    return address < fake->busy_end && fake->busy_start < address + size;
+  }
+  return MEMIO_is_busy();
+}
+
+static void fake_read(uint32_t address, void *buffer, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake_decay(address, size);
+  memcpy(buffer, &fake->buffer[address], size);
+  fake_corrupt(address, buffer, size);
+}
+
+/* Programming can only clear bits, so data is ANDed into the memory a 64-bit
+ * word at a time, which the compiler can widen further to SIMD. */
+static void fake_and(uint8_t *memory, const uint8_t *data, uint32_t size) {
+  uint32_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    uint64_t mask;
+    memcpy(&word, &memory[i], sizeof(word));
+    memcpy(&mask, &data[i], sizeof(mask));
+    word &= mask;
+    memcpy(&memory[i], &word, sizeof(word));
+  }
+  for (; i < size; i++) {
+    memory[i] &= data[i];
+  }
+}
+
+/* Programs are split at page boundaries into page program commands, as a page
+ * program wraps around within its page. */
+static void fake_prog(uint32_t address, const void *buffer, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  const uint8_t *data = buffer;
+  uint32_t page_size = fake->geometry.page_size;
+  uint32_t commands = 0;
+
+  while (size > 0) {
+    uint32_t chunk = page_size - address % page_size;
+    if (chunk > size) {
+      chunk = size;
+    }
+    fake_snapshot_touch(address, chunk);
+    if (fake_power_cut()) {
+      if (fake->cut_mode == FAKE_MEMORY_IO_Cut_Partial) {
+        fake_and(&fake->buffer[address], data, chunk / 2U);
+      }
+      break;
+    }
+    fake_and(&fake->buffer[address], data, chunk);
+    if (fake->errors_enabled &&
+        fake_random() <= fake->errors.prog_failure_rate) {
+      fake_prog_fail(address, data, chunk);
+    }
+    fake_wear_prog(address);
+    fake_clock_command(chunk);
+    fake_clock_busy(fake->timing.page_prog_us);
+    address += chunk;
+    data += chunk;
+    size -= chunk;
+    commands++;
+  }
+
+  fake->stats.page_programs += commands;
+}
+
+static void fake_progv(const MEMIO_Extent_t *extents, uint32_t count) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t transfers = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (i == 0 ||
+        extents[i].address != extents[i - 1].address + extents[i - 1].size) {
+      transfers++;
+    }
+    fake_prog(extents[i].address, extents[i].buffer, extents[i].size);
+  }
+  fake->stats.prog_extents += count;
+  fake->stats.prog_transfers += transfers;
+}
+
+static uint32_t fake_extents_start(const MEMIO_Extent_t *extents,
+                                   uint32_t count) {
+  uint32_t start = UINT32_MAX;
+  for (uint32_t i = 0; i < count; i++) {
+    if (extents[i].address < start) {
+      start = extents[i].address;
+    }
+  }
+  return start;
+}
+
+static uint32_t fake_extents_end(const MEMIO_Extent_t *extents,
+                                 uint32_t count) {
+  uint32_t end = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (extents[i].address + extents[i].size > end) {
+      end = extents[i].address + extents[i].size;
+    }
+  }
+  return end;
+}
+
+/* Starts an erase command and tells whether power is lost while it runs. An
+ * interrupted erase in partial mode leaves the first half of the region
+ * erased and the rest untouched. */
+static bool fake_erase_start(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake_snapshot_touch(address, size);
+  if (!fake_power_cut()) {
+    return false;
+  }
+  if (fake->cut_mode == FAKE_MEMORY_IO_Cut_Partial) {
+    memset(&fake->buffer[address], 0xFF, size / 2U);
+  }
+  return true;
+}
+
+static void fake_erase(uint32_t address) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  address &= ~(fake->geometry.sector_size - 1U);
+  if (fake_erase_start(address, fake->geometry.sector_size)) {
+    return;
+  }
+  memset(&fake->buffer[address], 0xFF, fake->geometry.sector_size);
+  fake_wear_erase(address, fake->geometry.sector_size);
+  fake->stats.erase_commands++;
+  fake->stats.sector_erases++;
+  fake_clock_command(0);
+  fake_clock_busy(fake->timing.sector_erase_us);
+}
+
+static int32_t fake_erase_range(uint32_t address, uint32_t length) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  uint32_t sector_size = fake->geometry.sector_size;
+  uint32_t block_size = fake->geometry.block_size;
+  uint32_t half_block_size = fake->geometry.block_size / 2U;
+
+  if (sector_size == 0 || half_block_size == 0) {
+    return -1;
+  }
+  if (address % sector_size != 0 || length % sector_size != 0) {
+    return -1;
+  }
+
+  if (address == 0 && length == fake->geometry.size) {
+    if (fake_erase_start(address, length)) {
+      return 0;
+    }
+    memset(fake->buffer, 0xFF, length);
+    fake_wear_erase(0, length);
+    fake->stats.erase_commands++;
+    fake->stats.chip_erases++;
+    fake_clock_command(0);
+    fake_clock_busy(fake->timing.chip_erase_us);
+    return 1;
+  }
+
+  int32_t commands = 0;
+  while (length > 0) {
+    uint32_t erase_size = sector_size;
+    uint32_t erase_us = fake->timing.sector_erase_us;
+    if (address % block_size == 0 && length >= block_size) {
+      erase_size = block_size;
+      erase_us = fake->timing.block_erase_us;
+      fake->stats.block_erases++;
+    } else if (address % half_block_size == 0 && length >= half_block_size) {
+      erase_size = half_block_size;
+      erase_us = fake->timing.half_block_erase_us;
+      fake->stats.half_block_erases++;
+    } else {
+      fake->stats.sector_erases++;
+    }
+
+    if (fake_erase_start(address, erase_size)) {
+      break;
+    }
+    memset(&fake->buffer[address], 0xFF, erase_size);
+    fake_wear_erase(address, erase_size);
+    fake->stats.erase_commands++;
+    fake_clock_command(0);
+    fake_clock_busy(erase_us);
+    commands++;
+    address += erase_size;
+    length -= erase_size;
+  }
+
+  return commands;
+}
+
+static MEMIO_Status_t fake_start_async(MEMIO_Callback_t callback,
+                                       void *context) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  fake->async_pending = true;
+  fake->async_status = MEMIO_Status_Ok;
+  fake->async_callback = callback;
+  fake->async_context = context;
   return MEMIO_Status_Ok;
 }
 
+MEMIO_Status_t MEMIO_get_geometry(MEMIO_Geometry_t *geometry) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  *geometry = fake->geometry;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_read(uint32_t address, void *buffer, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake_read_blocked(address, size)) {
+    return MEMIO_Status_Err;
+  }
+  fake_read(address, buffer, size);
+  fake_clock_command(size);
+  fake->stats.read_extents++;
+  fake->stats.read_transfers++;
+  return MEMIO_Status_Ok;
+}
+
+/* Length of the erased prefix of data, a 64-bit word at a time. */
+static uint32_t fake_blank_length(const uint8_t *data, uint32_t size) {
+  uint32_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, &data[i], sizeof(word));
+    if (word != UINT64_MAX) {
+      break;
+    }
+  }
+  for (; i < size; i++) {
+    if (data[i] != 0xFF) {
+      break;
+    }
+  }
+  return i;
+}
+
+MEMIO_Status_t MEMIO_is_erased(uint32_t address, uint32_t size, bool *erased) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake_read_blocked(address, size)) {
+    return MEMIO_Status_Err;
+  }
+
+  uint8_t chunk[FAKE_VIEW_CHUNK_SIZE];
+  uint32_t i = 0;
+  fake_decay(address, size);
+  while (i < size) {
+    const uint8_t *data;
+    uint32_t length = fake_view(address + i, size - i, chunk, &data);
+    uint32_t blank = fake_blank_length(data, length);
+    i += blank;
+    if (blank < length) {
+      break;
+    }
+  }
+
+  *erased = (i == size);
+  fake_clock_command(i < size ? i + 1U : size);
+  fake->stats.blank_checks++;
+  return MEMIO_Status_Ok;
+}
+
+static void fake_crc_table_init(void) {
+  for (uint32_t i = 0; i < 256U; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ ((crc & 1U) ? 0xEDB88320U : 0U);
+    }
+    fake_crc_table[0][i] = crc;
+  }
+  for (uint32_t i = 0; i < 256U; i++) {
+    for (int slice = 1; slice < 4; slice++) {
+      uint32_t prev = fake_crc_table[slice - 1][i];
+      fake_crc_table[slice][i] = (prev >> 8) ^ fake_crc_table[0][prev & 0xFFU];
+    }
+  }
+}
+
+static uint32_t fake_crc_update(uint32_t value, const uint8_t *data,
+                                uint32_t size) {
+  uint32_t i = 0;
+  for (; i + 4U <= size; i += 4U) {
+    value ^= (uint32_t)data[i] | ((uint32_t)data[i + 1] << 8) |
+             ((uint32_t)data[i + 2] << 16) | ((uint32_t)data[i + 3] << 24);
+    value = fake_crc_table[3][value & 0xFFU] ^
+            fake_crc_table[2][(value >> 8) & 0xFFU] ^
+            fake_crc_table[1][(value >> 16) & 0xFFU] ^
+            fake_crc_table[0][value >> 24];
+  }
+  for (; i < size; i++) {
+    value = (value >> 8) ^ fake_crc_table[0][(value ^ data[i]) & 0xFFU];
+  }
+  return value;
+}
+
+MEMIO_Status_t MEMIO_crc32(uint32_t address, uint32_t size, uint32_t *crc) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake_read_blocked(address, size)) {
+    return MEMIO_Status_Err;
+  }
+  pthread_once(&fake_crc_table_once, fake_crc_table_init);
+
+  uint8_t chunk[FAKE_VIEW_CHUNK_SIZE];
+  uint32_t value = *crc;
+  fake_decay(address, size);
+  for (uint32_t i = 0; i < size;) {
+    const uint8_t *data;
+    uint32_t length = fake_view(address + i, size - i, chunk, &data);
+    value = fake_crc_update(value, data, length);
+    i += length;
+  }
+
+  *crc = value;
+  fake_clock_command(size);
+  fake->stats.crcs++;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_compare(uint32_t address, const void *buffer,
+                             uint32_t size, int *result) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake_read_blocked(address, size)) {
+    return MEMIO_Status_Err;
+  }
+
+  uint8_t chunk[FAKE_VIEW_CHUNK_SIZE];
+  const uint8_t *expected = buffer;
+  *result = 0;
+  fake_decay(address, size);
+  for (uint32_t i = 0; i < size && *result == 0;) {
+    const uint8_t *data;
+    uint32_t length = fake_view(address + i, size - i, chunk, &data);
+    *result = memcmp(data, &expected[i], length);
+    i += length;
+  }
+  fake_clock_command(size);
+  fake->stats.compares++;
+  return MEMIO_Status_Ok;
+}
+
+const void *MEMIO_map(uint32_t address, uint32_t size) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, size) || MEMIO_is_busy()) {
+    return NULL;
+  }
+  return &fake->buffer[address];
+}
+
 MEMIO_Status_t MEMIO_prog(uint32_t address, const void *buffer, uint32_t size) {
-  for (uint32_t i = 0; i < size; i++) {
-    fake_buffer[address + i] &= ((const uint8_t *)buffer)[i];
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, size) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_prog(address, buffer, size);
+  fake->stats.prog_extents++;
+  fake->stats.prog_transfers++;
+  fake_start_busy(address, address + size);
+  fake_clock_sync();
+  return fake->powered_off ? MEMIO_Status_Err : MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_readv(const MEMIO_Extent_t *extents, uint32_t count) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  for (uint32_t i = 0; i < count; i++) {
+    if (fake_read_blocked(extents[i].address, extents[i].size)) {
+      return MEMIO_Status_Err;
+    }
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    if (i == 0 ||
+        extents[i].address != extents[i - 1].address + extents[i - 1].size) {
+      fake->stats.read_transfers++;
+      fake_clock_command(0);
+    }
+    fake_read(extents[i].address, extents[i].buffer, extents[i].size);
+    fake->clock_ns += (uint64_t)extents[i].size * fake->timing.byte_ns;
+    fake->stats.read_extents++;
   }
   return MEMIO_Status_Ok;
 }
+
+MEMIO_Status_t MEMIO_progv(const MEMIO_Extent_t *extents, uint32_t count) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts_extents(extents, count) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_progv(extents, count);
+  fake_start_busy(fake_extents_start(extents, count),
+                  fake_extents_end(extents, count));
+  fake_clock_sync();
+  return fake->powered_off ? MEMIO_Status_Err : MEMIO_Status_Ok;
+}
+
 MEMIO_Status_t MEMIO_erase(uint32_t address) {
-  address &= 0xFFFF000;
-  for (uint32_t i = 0; i < 4096; i++) {
-    fake_buffer[address + i] = 0xFF;
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, 1) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_erase(address);
+  fake_start_busy(address, address + fake->geometry.sector_size);
+  fake_clock_sync();
+  return fake->powered_off ? MEMIO_Status_Err : MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_erase_range(uint32_t address, uint32_t length) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, length) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  int32_t commands = fake_erase_range(address, length);
+  if (commands < 0) {
+    return MEMIO_Status_Err;
   }
+  fake_start_busy(address, address + length);
+  fake_clock_sync();
+  return fake->powered_off ? MEMIO_Status_Err : MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_prog_async(uint32_t address, const void *buffer,
+                                uint32_t size, MEMIO_Callback_t callback,
+                                void *context) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, size) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_prog(address, buffer, size);
+  fake->stats.prog_extents++;
+  fake->stats.prog_transfers++;
+  fake_start_busy(address, address + size);
+  if (fake->powered_off) {
+    return MEMIO_Status_Err;
+  }
+  return fake_start_async(callback, context);
+}
+
+MEMIO_Status_t MEMIO_progv_async(const MEMIO_Extent_t *extents, uint32_t count,
+                                 MEMIO_Callback_t callback, void *context) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts_extents(extents, count) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_progv(extents, count);
+  fake_start_busy(fake_extents_start(extents, count),
+                  fake_extents_end(extents, count));
+  if (fake->powered_off) {
+    return MEMIO_Status_Err;
+  }
+  return fake_start_async(callback, context);
+}
+
+MEMIO_Status_t MEMIO_erase_async(uint32_t address, MEMIO_Callback_t callback,
+                                 void *context) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, 1) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  fake_erase(address);
+  fake_start_busy(address, address + fake->geometry.sector_size);
+  if (fake->powered_off) {
+    return MEMIO_Status_Err;
+  }
+  return fake_start_async(callback, context);
+}
+
+MEMIO_Status_t MEMIO_erase_range_async(uint32_t address, uint32_t length,
+                                       MEMIO_Callback_t callback,
+                                       void *context) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake_accepts(address, length) || MEMIO_is_busy()) {
+    return MEMIO_Status_Err;
+  }
+  int32_t commands = fake_erase_range(address, length);
+  if (commands < 0) {
+    return MEMIO_Status_Err;
+  }
+  fake_start_busy(address, address + length);
+  if (fake->powered_off) {
+    return MEMIO_Status_Err;
+  }
+  return fake_start_async(callback, context);
+}
+
+bool MEMIO_is_busy(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->suspended || fake->clock_ns < fake->clock_ready_ns) {
+    return true;
+  }
+
+  if (fake->async_pending) {
+    fake->async_pending = false;
+    if (fake->async_callback != NULL) {
+      fake->async_callback(fake->async_status, fake->async_context);
+    }
+  }
+  return false;
+}
+
+MEMIO_Status_t MEMIO_wait(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->suspended) {
+    return MEMIO_Status_Err;
+  }
+  fake_clock_sync();
+  MEMIO_is_busy();
+  return fake->async_status;
+}
+
+MEMIO_Status_t MEMIO_suspend(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (fake->suspended || fake->clock_ns >= fake->clock_ready_ns) {
+    return MEMIO_Status_Err;
+  }
+
+  fake->clock_ns += (uint64_t)fake->timing.suspend_us * 1000U;
+  fake->clock_suspended_ns = (fake->clock_ns < fake->clock_ready_ns)
+                                ? fake->clock_ready_ns - fake->clock_ns
+                                : 0;
+  fake->suspended = true;
+  fake->stats.suspends++;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMIO_resume(void) {
+  FAKE_MEMORY_IO_Device_t *fake = fake_device();
+  if (!fake->suspended) {
+    return MEMIO_Status_Err;
+  }
+
+  fake->suspended = false;
+  fake->clock_ready_ns = fake->clock_ns + fake->clock_suspended_ns +
+                         (uint64_t)fake->timing.resume_us * 1000U;
+  fake->stats.device_busy_us += fake->timing.resume_us;
   return MEMIO_Status_Ok;
-}
\ No newline at end of file
+}
@@ -26,7 +26,232 @@
 #define FAKE_MEMORY_IO_H__
 
 #include "memory_io.h"
+#include <stddef.h>
+#include <stdio.h>
+
+/* Sectors tracked for wear and snapshots, a 256 MiB device of 4 KiB sectors */
+#define FAKE_MEMORY_IO_SECTORS_MAX 65536U
+#define FAKE_MEMORY_IO_WEAR_HISTOGRAM_BINS 10U
+#define FAKE_MEMORY_IO_STUCK_BITS_MAX 16U
+
+/**
+ * @brief Bus activity counters of the fake memory.
+ *
+ * A transfer is one command sent to the device; adjacent extents of a vectored
+ * call share a single transfer.
+ */
+typedef struct {
+  uint32_t read_extents;
+  uint32_t read_transfers;
+  uint32_t prog_extents;
+  uint32_t prog_transfers; /**< Write-enable and status-poll sequences */
+  uint32_t page_programs;  /**< Page program commands */
+  uint32_t erase_commands;
+  uint32_t sector_erases;
+  uint32_t half_block_erases;
+  uint32_t block_erases;
+  uint32_t chip_erases;
+  uint32_t suspends;
+  uint32_t blank_checks;
+  uint32_t crcs;
+  uint32_t compares;
+  uint32_t bit_flips; /**< Bits corrupted by the error model */
+  uint64_t device_busy_us; /**< Virtual time the device spent busy */
+  uint64_t host_wait_us;   /**< Virtual time the caller spent blocked on the
+                              device */
+} FAKE_MEMORY_IO_Stats_t;
+
+/**
+ * @brief Operation costs of the virtual clock.
+ *
+ * Defaults to typical GD25Q16C figures. Every command costs command_ns plus
+ * byte_ns per data byte on the bus; programs and erases then keep the device
+ * busy for the given time. The device reports busy until the virtual clock
+ * reaches the end of that time, which waiting for the device does at once.
+ */
+typedef struct {
+  uint32_t command_ns; /**< Opcode, address and dummy phases */
+  uint32_t byte_ns;    /**< Data phase, per byte */
+  uint32_t page_prog_us;
+  uint32_t sector_erase_us;
+  uint32_t half_block_erase_us;
+  uint32_t block_erase_us;
+  uint32_t chip_erase_us;
+  uint32_t suspend_us; /**< Latency until a suspended device accepts reads */
+  uint32_t resume_us;  /**< Busy time added back by a resume */
+} FAKE_MEMORY_IO_Timing_t;
+
+/**
+ * @brief Wear of one sector.
+ */
+typedef struct {
+  uint32_t erases;
+  uint32_t programs; /**< Page program commands */
+} FAKE_MEMORY_IO_Wear_t;
+
+/**
+ * @brief Distribution of the erases over the sectors of the device.
+ */
+typedef struct {
+  uint32_t sectors;
+  uint32_t min_erases;
+  uint32_t max_erases;
+  double mean_erases;
+  double stddev_erases;
+  uint32_t histogram_bin_width; /**< Erase counts covered by each bin */
+  uint32_t histogram[FAKE_MEMORY_IO_WEAR_HISTOGRAM_BINS];
+  double projected_runs; /**< Workload runs until the most worn sector hits
+                            the endurance, 0 if nothing was erased */
+} FAKE_MEMORY_IO_Wear_Report_t;
+
+/**
+ * @brief What an interrupted command leaves behind when power is cut.
+ */
+typedef enum {
+  FAKE_MEMORY_IO_Cut_Clean,   /**< The interrupted command has no effect */
+  FAKE_MEMORY_IO_Cut_Partial, /**< Half of the page is programmed, or half of
+                                 the region is erased */
+} FAKE_MEMORY_IO_Cut_Mode_t;
+
+/**
+ * @brief Rates of the error model.
+ *
+ * Each rate is the probability for one bit to be affected. Read errors are
+ * transient and only corrupt the data returned, the other errors change the
+ * memory until the sector is erased again. Pointers from MEMIO_map() see the
+ * memory without the transient errors and stuck bits.
+ */
+typedef struct {
+  uint64_t seed;              /**< Seed of the pseudo-random generator */
+  double read_bit_error_rate; /**< Per bit read, flipped either way */
+  double prog_failure_rate;   /**< Per page program, which then silently leaves
+                                 one bit of the page unprogrammed */
+  double read_disturb_rate;   /**< Per erased bit of a sector, each time the
+                                 sector is read, the bit reads programmed */
+  double retention_rate;      /**< Per programmed bit of a sector, each second
+                                 of virtual time, the bit reads erased */
+} FAKE_MEMORY_IO_Errors_t;
+
+/**
+ * @brief Bit that always reads the same value.
+ */
+typedef struct {
+  uint32_t address;
+  uint8_t bit;
+  bool value;
+} FAKE_MEMORY_IO_Stuck_Bit_t;
+
+/**
+ * @brief How an image file is mapped by FAKE_MEMORY_IO_map_image().
+ */
+typedef enum {
+  FAKE_MEMORY_IO_Image_Private, /**< Copy-on-write, the file is never written */
+  FAKE_MEMORY_IO_Image_Shared,  /**< Changes persist in the file */
+} FAKE_MEMORY_IO_Image_Mode_t;
+
+/**
+ * @brief State of one fake memory device.
+ *
+ * The FAKE_MEMORY_IO_ and MEMIO_ functions act on the device selected by the
+ * calling thread, so devices driven from different threads do not interfere.
+ * Zero initialize a device, select it, then set its buffer.
+ */
+typedef struct FAKE_MEMORY_IO_Device {
+  uint8_t *buffer;
+  MEMIO_Geometry_t geometry;
+  FAKE_MEMORY_IO_Stats_t stats;
+
+  /* Wear counters per sector. Sectors past FAKE_MEMORY_IO_SECTORS_MAX are
+   * not tracked. */
+  uint32_t sector_erases[FAKE_MEMORY_IO_SECTORS_MAX];
+  uint32_t sector_progs[FAKE_MEMORY_IO_SECTORS_MAX];
+
+  /* Copy-on-write snapshot. The first time a sector is modified after the
+   * snapshot, its contents are saved at the same offset in the storage, so a
+   * restore only copies back the sectors marked dirty. */
+  uint8_t *snapshot;
+  uint8_t snapshot_dirty[FAKE_MEMORY_IO_SECTORS_MAX / 8U];
+
+  /* Image file mapped as the memory by FAKE_MEMORY_IO_map_image(), if any. */
+  uint8_t *image;
+  size_t image_size;
+
+  /* Virtual clock, the only time of the fake. Every command advances it by
+   * its bus time. Data is applied as soon as a command is issued, but the
+   * device reports busy until the clock reaches clock_ready_ns, which waiting
+   * for the device jumps to. busy_start and busy_end bound the memory the
+   * operation in progress works on. */
+  FAKE_MEMORY_IO_Timing_t timing;
+  uint64_t clock_ns;
+  uint64_t clock_ready_ns;
+  uint32_t busy_start;
+  uint32_t busy_end;
+
+  /* Power loss model. Once armed, power is cut while the page program or
+   * erase command that follows cut_after completed ones is running. From then
+   * on every command fails until power is restored. */
+  bool cut_armed;
+  uint32_t cut_after;
+  uint32_t cut_commands;
+  FAKE_MEMORY_IO_Cut_Mode_t cut_mode;
+  bool powered_off;
+
+  /* Suspend model. Suspending takes the suspend_us of the timing, freezes
+   * the remaining busy time, and resuming adds resume_us to it. Memory
+   * outside the region of the suspended operation can be read meanwhile. */
+  bool suspended;
+  uint64_t clock_suspended_ns;
+
+  /* Error model. Retention loss is applied when a sector is read, for the
+   * time elapsed since it was last erased or read. */
+  bool errors_enabled;
+  FAKE_MEMORY_IO_Errors_t errors;
+  uint64_t error_random;
+  FAKE_MEMORY_IO_Stuck_Bit_t stuck_bits[FAKE_MEMORY_IO_STUCK_BITS_MAX];
+  uint32_t stuck_bit_count;
+  uint64_t sector_aged_ns[FAKE_MEMORY_IO_SECTORS_MAX];
+
+  bool async_pending;
+  MEMIO_Status_t async_status;
+  MEMIO_Callback_t async_callback;
+  void *async_context;
+} FAKE_MEMORY_IO_Device_t;
+
+/**
+ * @brief Selects the device used by the calling thread.
+ *
+ * @param[in] device Device to use, NULL for the default device shared by all
+ * threads that select none.
+ */
+void FAKE_MEMORY_IO_select(FAKE_MEMORY_IO_Device_t *device);
+FAKE_MEMORY_IO_Device_t *FAKE_MEMORY_IO_selected(void);
 
 void FAKE_MEMORY_IO_set_buffer(uint8_t *buffer);
+bool FAKE_MEMORY_IO_map_image(const char *path, uint32_t size,
+                              FAKE_MEMORY_IO_Image_Mode_t mode);
+void FAKE_MEMORY_IO_unmap_image(void);
+void FAKE_MEMORY_IO_set_geometry(const MEMIO_Geometry_t *geometry);
+void FAKE_MEMORY_IO_set_busy_time(uint32_t prog_us, uint32_t erase_us);
+void FAKE_MEMORY_IO_set_suspend_time(uint32_t suspend_us, uint32_t resume_us);
+void FAKE_MEMORY_IO_set_timing(const FAKE_MEMORY_IO_Timing_t *timing);
+void FAKE_MEMORY_IO_get_timing(FAKE_MEMORY_IO_Timing_t *timing);
+uint64_t FAKE_MEMORY_IO_get_virtual_time_ns(void);
+void FAKE_MEMORY_IO_advance_virtual_time(uint64_t ns);
+void FAKE_MEMORY_IO_set_errors(const FAKE_MEMORY_IO_Errors_t *errors);
+bool FAKE_MEMORY_IO_add_stuck_bit(uint32_t address, uint8_t bit, bool value);
+void FAKE_MEMORY_IO_clear_errors(void);
+void FAKE_MEMORY_IO_get_wear(uint32_t sector, FAKE_MEMORY_IO_Wear_t *wear);
+void FAKE_MEMORY_IO_get_wear_report(uint32_t endurance_cycles,
+                                    FAKE_MEMORY_IO_Wear_Report_t *report);
+void FAKE_MEMORY_IO_print_wear_report(
+    FILE *stream, const FAKE_MEMORY_IO_Wear_Report_t *report);
+void FAKE_MEMORY_IO_reset_wear(void);
+void FAKE_MEMORY_IO_set_power_cut(uint32_t commands,
+                                  FAKE_MEMORY_IO_Cut_Mode_t mode);
+void FAKE_MEMORY_IO_restore_power(void);
+bool FAKE_MEMORY_IO_take_snapshot(uint8_t *storage);
+uint32_t FAKE_MEMORY_IO_restore_snapshot(void);
+void FAKE_MEMORY_IO_get_stats(FAKE_MEMORY_IO_Stats_t *stats);
+void FAKE_MEMORY_IO_reset_stats(void);
 
 #endif /* FAKE_MEMORY_IO_H__ */
\ No newline at end of file
@@ -0,0 +1,777 @@
+#include "CppUTest/TestHarness.h"
+#include <chrono>
+#include <thread>
+
+extern "C" {
+#include "fake_memory_io.h"
+#include "lfs/lfs_util.h"
+}
+
+static uint8_t fake_memory[4096 * 512] = {0};
+
+/* Fill the memory and hand it to the fake, which also resets its state. */
+static void reset_fake_memory(uint8_t fill) {
+  memset(fake_memory, fill, sizeof(fake_memory));
+  FAKE_MEMORY_IO_set_buffer(fake_memory);
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__vectored__io)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__vectored__io,
+     Adjacent__program__extents__are__merged__into__one__transfer) {
+  uint8_t page_a[256];
+  uint8_t page_b[256];
+  uint8_t page_c[256];
+  memset(page_a, 0xA5, sizeof(page_a));
+  memset(page_b, 0x5A, sizeof(page_b));
+  memset(page_c, 0x00, sizeof(page_c));
+
+  MEMIO_Extent_t extents[] = {
+      {0, page_a, sizeof(page_a)},
+      {256, page_b, sizeof(page_b)},
+      {4096, page_c, sizeof(page_c)},
+  };
+
+  MEMIO_Status_t status = MEMIO_progv(extents, 3);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(3, stats.prog_extents);
+  UNSIGNED_LONGS_EQUAL(2, stats.prog_transfers);
+
+  MEMCMP_EQUAL(page_a, &fake_memory[0], sizeof(page_a));
+  MEMCMP_EQUAL(page_b, &fake_memory[256], sizeof(page_b));
+  MEMCMP_EQUAL(page_c, &fake_memory[4096], sizeof(page_c));
+}
+
+TEST(Fake__memory__vectored__io,
+     Multi__page__program__is__split__at__page__boundaries) {
+  uint8_t data[1000];
+  for (size_t i = 0U; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 3U);
+  }
+
+  MEMIO_Status_t status = MEMIO_prog(100, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(1, stats.prog_transfers);
+  UNSIGNED_LONGS_EQUAL(5, stats.page_programs);
+  MEMCMP_EQUAL(data, &fake_memory[100], sizeof(data));
+}
+
+TEST(Fake__memory__vectored__io,
+     Adjacent__read__extents__are__merged__into__one__transfer) {
+  uint8_t head[16];
+  uint8_t tail[16];
+  uint8_t other[16];
+
+  for (size_t i = 0U; i < 32U; i++) {
+    fake_memory[i] = (uint8_t)i;
+  }
+
+  MEMIO_Extent_t extents[] = {
+      {0, head, sizeof(head)},
+      {16, tail, sizeof(tail)},
+      {1024, other, sizeof(other)},
+  };
+
+  MEMIO_Status_t status = MEMIO_readv(extents, 3);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(3, stats.read_extents);
+  UNSIGNED_LONGS_EQUAL(2, stats.read_transfers);
+
+  MEMCMP_EQUAL(&fake_memory[0], head, sizeof(head));
+  MEMCMP_EQUAL(&fake_memory[16], tail, sizeof(tail));
+  MEMCMP_EQUAL(&fake_memory[1024], other, sizeof(other));
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__erase__range)
+{
+    void setup() {
+        reset_fake_memory(0x00);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__erase__range, Largest__aligned__erase__command__is__used) {
+  MEMIO_Status_t status = MEMIO_erase_range(0, 64 * 1024 + 32 * 1024 + 4096);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(3, stats.erase_commands);
+  UNSIGNED_LONGS_EQUAL(1, stats.block_erases);
+  UNSIGNED_LONGS_EQUAL(1, stats.half_block_erases);
+  UNSIGNED_LONGS_EQUAL(1, stats.sector_erases);
+
+  BYTES_EQUAL(0xFF, fake_memory[0]);
+  BYTES_EQUAL(0xFF, fake_memory[64 * 1024 + 32 * 1024 + 4095]);
+  BYTES_EQUAL(0x00, fake_memory[64 * 1024 + 32 * 1024 + 4096]);
+}
+
+TEST(Fake__memory__erase__range, Unaligned__head__is__erased__by__sectors) {
+  MEMIO_Status_t status = MEMIO_erase_range(4096, 64 * 1024);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(0, stats.block_erases);
+  UNSIGNED_LONGS_EQUAL(1, stats.half_block_erases);
+  UNSIGNED_LONGS_EQUAL(8, stats.sector_erases);
+
+  BYTES_EQUAL(0x00, fake_memory[4095]);
+  BYTES_EQUAL(0xFF, fake_memory[4096]);
+  BYTES_EQUAL(0xFF, fake_memory[64 * 1024 + 4095]);
+  BYTES_EQUAL(0x00, fake_memory[64 * 1024 + 4096]);
+}
+
+TEST(Fake__memory__erase__range, Whole__device__uses__chip__erase) {
+  MEMIO_Status_t status = MEMIO_erase_range(0, sizeof(fake_memory));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(1, stats.erase_commands);
+  UNSIGNED_LONGS_EQUAL(1, stats.chip_erases);
+  BYTES_EQUAL(0xFF, fake_memory[sizeof(fake_memory) - 1]);
+}
+
+TEST(Fake__memory__erase__range, Unaligned__range__returns__error) {
+  MEMIO_Status_t status = MEMIO_erase_range(100, 4096);
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+
+  status = MEMIO_erase_range(0, 100);
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+}
+
+TEST(Fake__memory__erase__range, Unset__geometry__returns__error) {
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  geometry.block_size = 0;
+  FAKE_MEMORY_IO_set_geometry(&geometry);
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase_range(0, 4096));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase_range_async(0, 4096, NULL, NULL));
+
+  geometry.sector_size = 0;
+  FAKE_MEMORY_IO_set_geometry(&geometry);
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase_range(0, 4096));
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__blank__check)
+{
+    void setup() {
+        reset_fake_memory(0x00);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__blank__check, Blank__check__detects__programmed__bytes) {
+  bool erased = true;
+  MEMIO_Status_t status = MEMIO_is_erased(4096, 4096, &erased);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_FALSE(erased);
+
+  MEMIO_erase(4096);
+  status = MEMIO_is_erased(4096, 4096, &erased);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_TRUE(erased);
+
+  fake_memory[4096 + 4095] = 0xFE;
+  status = MEMIO_is_erased(4096, 4096, &erased);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_FALSE(erased);
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__offload)
+{
+    void setup() {
+        reset_fake_memory(0x00);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__offload, Crc__matches__the__littlefs__crc) {
+  for (size_t i = 0U; i < 1000U; i++) {
+    fake_memory[i] = (uint8_t)(i * 31U);
+  }
+
+  uint32_t crc = 0xFFFFFFFF;
+  MEMIO_Status_t status = MEMIO_crc32(3, 997, &crc);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(lfs_crc(0xFFFFFFFF, &fake_memory[3], 997), crc);
+}
+
+TEST(Fake__memory__offload, Compare__orders__like__memcmp) {
+  uint8_t data[16];
+  memset(data, 0x00, sizeof(data));
+  int result = 1;
+
+  MEMIO_Status_t status = MEMIO_compare(0, data, sizeof(data), &result);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  LONGS_EQUAL(0, result);
+
+  data[8] = 0x01;
+  status = MEMIO_compare(0, data, sizeof(data), &result);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK(result < 0);
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__virtual__clock)
+{
+    void setup() {
+        reset_fake_memory(0x00);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__virtual__clock, Virtual__clock__follows__timing__table) {
+  FAKE_MEMORY_IO_Timing_t timing;
+  FAKE_MEMORY_IO_get_timing(&timing);
+  timing.command_ns = 1000;
+  timing.byte_ns = 10;
+  timing.page_prog_us = 700;
+  timing.sector_erase_us = 40000;
+  uint8_t data[512];
+  memset(data, 0x00, sizeof(data));
+  FAKE_MEMORY_IO_set_timing(&timing);
+
+  MEMIO_erase(0);
+  UNSIGNED_LONGS_EQUAL(1000U + 40000000U,
+                       FAKE_MEMORY_IO_get_virtual_time_ns());
+
+  MEMIO_prog(0, data, sizeof(data));
+  UNSIGNED_LONGS_EQUAL(1000U + 40000000U + 2U * (1000U + 2560U + 700000U),
+                       FAKE_MEMORY_IO_get_virtual_time_ns());
+
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  MEMIO_read(0, data, 100);
+  UNSIGNED_LONGS_EQUAL(1000U + 1000U,
+                       FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns);
+
+  /* The device stays busy until the clock reaches the end of the erase */
+  MEMIO_erase_async(4096, NULL, NULL);
+  CHECK_TRUE(MEMIO_is_busy());
+  FAKE_MEMORY_IO_advance_virtual_time(40000000U - 1U);
+  CHECK_TRUE(MEMIO_is_busy());
+  FAKE_MEMORY_IO_advance_virtual_time(1U);
+  CHECK_FALSE(MEMIO_is_busy());
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__wear)
+{
+    void setup() {
+        reset_fake_memory(0x00);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__wear, Wear__is__counted__per__sector) {
+  uint8_t page[256];
+  memset(page, 0x00, sizeof(page));
+
+  MEMIO_erase_range(0, 64U * 1024U);
+  MEMIO_erase(4096);
+  MEMIO_prog(8192, page, sizeof(page));
+
+  FAKE_MEMORY_IO_Wear_t wear;
+  FAKE_MEMORY_IO_get_wear(1, &wear);
+  UNSIGNED_LONGS_EQUAL(2, wear.erases);
+  FAKE_MEMORY_IO_get_wear(2, &wear);
+  UNSIGNED_LONGS_EQUAL(1, wear.erases);
+  UNSIGNED_LONGS_EQUAL(1, wear.programs);
+
+  FAKE_MEMORY_IO_Wear_Report_t report;
+  FAKE_MEMORY_IO_get_wear_report(100000, &report);
+  UNSIGNED_LONGS_EQUAL(512, report.sectors);
+  UNSIGNED_LONGS_EQUAL(0, report.min_erases);
+  UNSIGNED_LONGS_EQUAL(2, report.max_erases);
+  DOUBLES_EQUAL(17.0 / 512.0, report.mean_erases, 1e-9);
+  UNSIGNED_LONGS_EQUAL(496, report.histogram[0]);
+  UNSIGNED_LONGS_EQUAL(15, report.histogram[1]);
+  UNSIGNED_LONGS_EQUAL(1, report.histogram[2]);
+  DOUBLES_EQUAL(50000.0, report.projected_runs, 1e-9);
+}
+
+static int async_callback_calls = 0;
+static MEMIO_Status_t async_callback_status = MEMIO_Status_Err;
+
+static void async_callback(MEMIO_Status_t status, void *context) {
+  async_callback_calls++;
+  async_callback_status = status;
+  (*(int *)context)++;
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__async__io)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+        FAKE_MEMORY_IO_set_busy_time(2000, 5000);
+        async_callback_calls = 0;
+        async_callback_status = MEMIO_Status_Err;
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__async__io, Program__completes__through__callback) {
+  uint8_t page[256];
+  int context = 0;
+  memset(page, 0x3C, sizeof(page));
+
+  MEMIO_Status_t status =
+      MEMIO_prog_async(512, page, sizeof(page), async_callback, &context);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_TRUE(MEMIO_is_busy());
+  CHECK_EQUAL(0, async_callback_calls);
+
+  status = MEMIO_wait();
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_EQUAL(1, async_callback_calls);
+  CHECK_EQUAL(1, context);
+  CHECK_EQUAL(MEMIO_Status_Ok, async_callback_status);
+  CHECK_FALSE(MEMIO_is_busy());
+  CHECK_EQUAL(1, async_callback_calls);
+
+  MEMCMP_EQUAL(page, &fake_memory[512], sizeof(page));
+}
+
+TEST(Fake__memory__async__io, Operations__are__rejected__while__busy) {
+  uint8_t data[16];
+  int context = 0;
+
+  MEMIO_Status_t status = MEMIO_erase_async(0, async_callback, &context);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  status = MEMIO_read(0, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+
+  status = MEMIO_erase_range_async(4096, 4096, async_callback, &context);
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+
+  MEMIO_wait();
+  status = MEMIO_read(0, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_EQUAL(1, async_callback_calls);
+}
+
+TEST(Fake__memory__async__io, Busy__time__is__accounted) {
+  uint8_t page[256];
+  memset(page, 0x00, sizeof(page));
+
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  MEMIO_prog(0, page, sizeof(page));
+  MEMIO_erase(4096);
+  uint64_t elapsed_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  /* Blocking calls wait out the whole busy time on the virtual clock */
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(7000U, stats.device_busy_us);
+  UNSIGNED_LONGS_EQUAL(7000U, stats.host_wait_us);
+  CHECK(elapsed_ns >= 7000000U);
+}
+
+TEST(Fake__memory__async__io, Suspended__erase__allows__reads__elsewhere) {
+  uint8_t data[16];
+  int context = 0;
+
+  FAKE_MEMORY_IO_set_suspend_time(20, 20);
+  fake_memory[8192] = 0x12;
+
+  MEMIO_Status_t status = MEMIO_erase_async(4096, async_callback, &context);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  status = MEMIO_suspend();
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_TRUE(MEMIO_is_busy());
+
+  status = MEMIO_read(8192, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  BYTES_EQUAL(0x12, data[0]);
+
+  status = MEMIO_read(4096, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+
+  status = MEMIO_erase_async(8192, async_callback, &context);
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+
+  status = MEMIO_resume();
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  status = MEMIO_wait();
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_EQUAL(1, async_callback_calls);
+
+  status = MEMIO_suspend();
+  CHECK_EQUAL(MEMIO_Status_Err, status);
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__bulk__io)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__bulk__io, Out__of__bounds__accesses__are__rejected) {
+  uint8_t data[16];
+  memset(data, 0x00, sizeof(data));
+
+  uint32_t end = sizeof(fake_memory);
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_read(end - 8, data, sizeof(data)));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_prog(end - 8, data, sizeof(data)));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase(end));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase_range(end - 4096, 8192));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_read(UINT32_MAX, data, 2));
+  CHECK_EQUAL(MEMIO_Status_Ok, MEMIO_prog(end - 16, data, sizeof(data)));
+}
+
+/* The byte-at-a-time loops the fake used to run, kept as a reference. */
+static void byte_loop_prog(uint8_t *memory, const uint8_t *data,
+                           uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    memory[i] &= data[i];
+  }
+}
+
+static void byte_loop_read(const uint8_t *memory, uint8_t *buffer,
+                           uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    buffer[i] = memory[i];
+  }
+}
+
+static void byte_loop_erase(uint8_t *memory, uint32_t size) {
+  for (uint32_t i = 0; i < size; i++) {
+    memory[i] = 0xFF;
+  }
+}
+
+static long long elapsed_us(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+TEST(Fake__memory__bulk__io, Bulk__io__matches__byte__loops) {
+  static uint8_t data[sizeof(fake_memory)];
+  static uint8_t reference[sizeof(fake_memory)];
+  static uint8_t read_back[sizeof(fake_memory)];
+  const uint32_t passes = 8;
+
+  for (size_t i = 0U; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(~(i * 7U));
+  }
+  memset(reference, 0xFF, sizeof(reference));
+
+  /* An odd offset and size exercise the byte head and tail of the word loop */
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    byte_loop_prog(&reference[pass], data, sizeof(data) - 2U * pass - 1U);
+    MEMIO_prog(pass, data, sizeof(data) - 2U * pass - 1U);
+  }
+  for (uint32_t pass = 0; pass < passes; pass++) {
+    MEMIO_read(0, read_back, sizeof(read_back));
+  }
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  MEMCMP_EQUAL(reference, fake_memory, sizeof(fake_memory));
+  MEMCMP_EQUAL(reference, read_back, sizeof(read_back));
+  UNSIGNED_LONGS_EQUAL(passes, stats.prog_transfers);
+  UNSIGNED_LONGS_EQUAL(passes, stats.read_transfers);
+}
+
+/* Wall time depends on the host, so it is only reported, never asserted. */
+TEST(Fake__memory__bulk__io, Bulk__io__timing__is__reported) {
+  static uint8_t data[sizeof(fake_memory)];
+  static uint8_t reference[sizeof(fake_memory)];
+  static uint8_t read_back[sizeof(fake_memory)];
+  const int passes = 8;
+  memset(data, 0x5A, sizeof(data));
+
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    byte_loop_erase(reference, sizeof(reference));
+    byte_loop_prog(reference, data, sizeof(reference));
+    byte_loop_read(reference, read_back, sizeof(read_back));
+  }
+  long long loop_us = elapsed_us(start);
+
+  start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    MEMIO_erase_range(0, sizeof(fake_memory));
+    MEMIO_prog(0, data, sizeof(data));
+    MEMIO_read(0, read_back, sizeof(read_back));
+  }
+  long long fake_us = elapsed_us(start);
+
+  char report[96];
+  snprintf(report, sizeof(report), "byte loops: %lld us, bulk fake: %lld us",
+           loop_us, fake_us);
+  UT_PRINT(report);
+  MEMCMP_EQUAL(reference, fake_memory, sizeof(fake_memory));
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__image)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__image, Shared__image__persists__across__mappings) {
+  const char *image_path = "./fake_memory_image.bin";
+  uint8_t data[256];
+  uint8_t read_back[sizeof(data)];
+  memset(data, 0x5A, sizeof(data));
+  remove(image_path);
+
+  bool mapped = FAKE_MEMORY_IO_map_image(image_path, 64U * 1024U,
+                                         FAKE_MEMORY_IO_Image_Shared);
+  CHECK_TRUE(mapped);
+
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  UNSIGNED_LONGS_EQUAL(64U * 1024U, geometry.size);
+
+  bool erased = false;
+  MEMIO_is_erased(0, geometry.size, &erased);
+  CHECK_TRUE(erased);
+
+  MEMIO_Status_t status = MEMIO_prog(4096, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  FAKE_MEMORY_IO_unmap_image();
+
+  mapped = FAKE_MEMORY_IO_map_image(image_path, 0,
+                                    FAKE_MEMORY_IO_Image_Shared);
+  CHECK_TRUE(mapped);
+  status = MEMIO_read(4096, read_back, sizeof(read_back));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  MEMCMP_EQUAL(data, read_back, sizeof(data));
+
+  FAKE_MEMORY_IO_unmap_image();
+  remove(image_path);
+}
+
+TEST(Fake__memory__image, Private__image__must__exist) {
+  bool mapped = FAKE_MEMORY_IO_map_image("./missing_image.bin", 0,
+                                         FAKE_MEMORY_IO_Image_Private);
+  CHECK_FALSE(mapped);
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__snapshot)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+    }
+};
+// clang-format on
+
+TEST(Fake__memory__snapshot, Restore__only__rewrites__modified__sectors) {
+  static uint8_t original[sizeof(fake_memory)];
+  static uint8_t snapshot[sizeof(fake_memory)];
+  uint8_t page[256];
+  memset(page, 0x00, sizeof(page));
+  for (size_t i = 0U; i < sizeof(fake_memory); i++) {
+    fake_memory[i] = (uint8_t)(i / 4096U);
+  }
+  memcpy(original, fake_memory, sizeof(original));
+
+  CHECK_TRUE(FAKE_MEMORY_IO_take_snapshot(snapshot));
+  MEMIO_prog(4096 - 100, page, sizeof(page));
+  MEMIO_erase(5 * 4096);
+  MEMIO_prog(5 * 4096, page, sizeof(page));
+
+  UNSIGNED_LONGS_EQUAL(3, FAKE_MEMORY_IO_restore_snapshot());
+  MEMCMP_EQUAL(original, fake_memory, sizeof(original));
+
+  MEMIO_erase(0);
+  UNSIGNED_LONGS_EQUAL(1, FAKE_MEMORY_IO_restore_snapshot());
+  MEMCMP_EQUAL(original, fake_memory, sizeof(original));
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__errors)
+{
+    FAKE_MEMORY_IO_Errors_t errors;
+
+    void setup() {
+        reset_fake_memory(0xFF);
+        memset(&errors, 0, sizeof(errors));
+        errors.seed = 1;
+    }
+};
+// clang-format on
+
+static uint32_t count_bits(const uint8_t *data, uint32_t size, uint8_t value) {
+  uint32_t bits = 0;
+  for (uint32_t i = 0; i < size; i++) {
+    for (uint8_t x = (uint8_t)(data[i] ^ value); x != 0U; x &= x - 1U) {
+      bits++;
+    }
+  }
+  return bits;
+}
+
+TEST(Fake__memory__errors, Read__errors__are__transient) {
+  static uint8_t read_back[sizeof(fake_memory)];
+  errors.read_bit_error_rate = 1e-4;
+  FAKE_MEMORY_IO_set_errors(&errors);
+
+  MEMIO_read(0, read_back, sizeof(read_back));
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  uint32_t flipped = count_bits(read_back, sizeof(read_back), 0xFF);
+  UNSIGNED_LONGS_EQUAL(stats.bit_flips, flipped);
+  /* 1678 expected out of 16 Mibit */
+  CHECK(flipped > 1400U && flipped < 2000U);
+  UNSIGNED_LONGS_EQUAL(0, count_bits(fake_memory, sizeof(fake_memory), 0xFF));
+}
+
+TEST(Fake__memory__errors, Stuck__bits__and__failed__programs__read__wrong) {
+  uint8_t page[256];
+  uint8_t read_back[sizeof(page)];
+  int result = 0;
+  memset(page, 0x00, sizeof(page));
+
+  CHECK_TRUE(FAKE_MEMORY_IO_add_stuck_bit(4096 + 10, 3, false));
+  MEMIO_read(4096, read_back, sizeof(read_back));
+  UNSIGNED_LONGS_EQUAL(0xF7, read_back[10]);
+  UNSIGNED_LONGS_EQUAL(0xFF, fake_memory[4096 + 10]);
+
+  errors.prog_failure_rate = 1.0;
+  FAKE_MEMORY_IO_set_errors(&errors);
+  MEMIO_prog(0, page, sizeof(page));
+  UNSIGNED_LONGS_EQUAL(1, count_bits(fake_memory, sizeof(page), 0x00));
+  MEMIO_compare(0, page, sizeof(page), &result);
+  CHECK(result != 0);
+
+  FAKE_MEMORY_IO_clear_errors();
+  MEMIO_read(4096, read_back, sizeof(read_back));
+  UNSIGNED_LONGS_EQUAL(0xFF, read_back[10]);
+}
+
+TEST(Fake__memory__errors, Retention__and__disturb__persist__until__erase) {
+  static uint8_t sector[4096];
+  static uint8_t read_back[sizeof(sector)];
+  memset(sector, 0x00, sizeof(sector));
+  MEMIO_erase(0);
+  MEMIO_prog(0, sector, sizeof(sector));
+  MEMIO_erase(4096);
+
+  errors.retention_rate = 1e-6;
+  errors.read_disturb_rate = 1e-5;
+  FAKE_MEMORY_IO_set_errors(&errors);
+  FAKE_MEMORY_IO_advance_virtual_time(1000ULL * 1000000000ULL);
+
+  /* About 33 of the programmed bits are lost, in 1000 s at 1e-6 per s */
+  MEMIO_read(0, read_back, sizeof(read_back));
+  uint32_t lost = count_bits(read_back, sizeof(read_back), 0x00);
+  CHECK(lost > 10U && lost < 70U);
+  UNSIGNED_LONGS_EQUAL(lost, count_bits(fake_memory, sizeof(sector), 0x00));
+
+  /* About 33 of the erased bits are disturbed by 100 reads at 1e-5 */
+  for (int i = 0; i < 100; i++) {
+    MEMIO_read(4096, read_back, sizeof(read_back));
+  }
+  uint32_t disturbed = count_bits(read_back, sizeof(read_back), 0xFF);
+  CHECK(disturbed > 10U && disturbed < 70U);
+
+  MEMIO_erase(4096);
+  UNSIGNED_LONGS_EQUAL(
+      0, count_bits(&fake_memory[4096], sizeof(read_back), 0xFF));
+}
+
+// clang-format off
+TEST_GROUP(Fake__memory__devices)
+{
+    void setup() {
+        reset_fake_memory(0xFF);
+    }
+
+    void teardown() {
+        FAKE_MEMORY_IO_select(NULL);
+    }
+};
+// clang-format on
+
+enum { DEVICE_COUNT = 4, DEVICE_SIZE = 64 * 1024 };
+
+static FAKE_MEMORY_IO_Device_t devices[DEVICE_COUNT];
+static uint8_t device_memory[DEVICE_COUNT][DEVICE_SIZE];
+static uint8_t device_read_back[DEVICE_COUNT][DEVICE_SIZE];
+static FAKE_MEMORY_IO_Stats_t device_stats[DEVICE_COUNT];
+
+static void device_workload(unsigned index) {
+  uint8_t data[256];
+  MEMIO_Geometry_t geometry;
+
+  memset(&devices[index], 0, sizeof(devices[index]));
+  FAKE_MEMORY_IO_select(&devices[index]);
+  memset(device_memory[index], 0xFF, DEVICE_SIZE);
+  FAKE_MEMORY_IO_set_buffer(device_memory[index]);
+  MEMIO_get_geometry(&geometry);
+  geometry.size = DEVICE_SIZE;
+  FAKE_MEMORY_IO_set_geometry(&geometry);
+
+  memset(data, (int)(0x10U + index), sizeof(data));
+  for (unsigned round = 0U; round <= index; round++) {
+    MEMIO_erase(0);
+    for (uint32_t address = 0U; address < DEVICE_SIZE / 2U;
+         address += sizeof(data)) {
+      MEMIO_prog(address, data, sizeof(data));
+    }
+  }
+  MEMIO_read(0, device_read_back[index], DEVICE_SIZE);
+  FAKE_MEMORY_IO_get_stats(&device_stats[index]);
+}
+
+TEST(Fake__memory__devices, Threads__drive__independent__devices) {
+  std::thread threads[DEVICE_COUNT];
+  for (unsigned i = 0U; i < DEVICE_COUNT; i++) {
+    threads[i] = std::thread(device_workload, i);
+  }
+  for (unsigned i = 0U; i < DEVICE_COUNT; i++) {
+    threads[i].join();
+  }
+
+  for (unsigned i = 0U; i < DEVICE_COUNT; i++) {
+    UNSIGNED_LONGS_EQUAL(i + 1U, device_stats[i].erase_commands);
+    UNSIGNED_LONGS_EQUAL((i + 1U) * (DEVICE_SIZE / 2U / 256U),
+                         device_stats[i].page_programs);
+    CHECK(FAKE_MEMORY_IO_selected() != &devices[i]);
+    for (uint32_t address = 0U; address < DEVICE_SIZE / 2U; address++) {
+      UNSIGNED_LONGS_EQUAL(0x10U + i, device_read_back[i][address]);
+    }
+    UNSIGNED_LONGS_EQUAL(0xFF, device_read_back[i][DEVICE_SIZE - 1U]);
+  }
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  UNSIGNED_LONGS_EQUAL(0, stats.page_programs);
+  UNSIGNED_LONGS_EQUAL(0xFF, fake_memory[0]);
+}
@@ -1,22 +1,73 @@
 #include "CppUTest/TestHarness.h"
+#include <algorithm>
 #include <stdexcept>
 #include <stdio.h>
 
 extern "C" {
+#include "block_trace.h"
 #include "fake_memory_io.h"
 #include "file_system.h"
+#include "power_loss_sweep.h"
 }
 
 static uint8_t memory_buffer[4096 * 512] = {0};
+static uint8_t large_memory_buffer[4096 * 2048] = {0};
+static uint8_t large_file_data[3 * 1024 * 1024] = {0};
+static uint8_t power_loss_image[4096 * 512] = {0};
+
+/* Images the tests start from, built once. memory_image is the one
+ * memory_buffer holds, NULL after a test wrote memory_buffer directly; the
+ * fake tracks every other change in memory_snapshot, so only the sectors a
+ * test modified are copied back. */
+static uint8_t blank_image[sizeof(memory_buffer)];
+static uint8_t formatted_image[sizeof(memory_buffer)];
+static uint8_t memory_snapshot[sizeof(memory_buffer)];
+static const uint8_t *memory_image = nullptr;
 
 static void load_binary_image(const char *filepath);
 
+static void start_from_image(const uint8_t *image) {
+  if (memory_image != image) {
+    memcpy(memory_buffer, image, sizeof(memory_buffer));
+  }
+  FAKE_MEMORY_IO_set_buffer(memory_buffer);
+  memory_image = FAKE_MEMORY_IO_take_snapshot(memory_snapshot) ? image
+                                                               : nullptr;
+}
+
+static void start_blank() {
+  static bool built = false;
+  if (!built) {
+    memset(blank_image, 0xFF, sizeof(blank_image));
+    built = true;
+  }
+  start_from_image(blank_image);
+}
+
+static void start_formatted() {
+  static bool built = false;
+  if (!built) {
+    start_blank();
+    FS_init();
+    FS_deinit();
+    memcpy(formatted_image, memory_buffer, sizeof(formatted_image));
+    memory_image = formatted_image;
+    built = true;
+  }
+  start_from_image(formatted_image);
+}
+
+static void restore_image() { FAKE_MEMORY_IO_restore_snapshot(); }
+
 // clang-format off
 TEST_GROUP(File__system__initialization)
 {
     void setup() {
-        memset(memory_buffer, 0xFF, sizeof(memory_buffer));
-        FAKE_MEMORY_IO_set_buffer(memory_buffer);
+        start_blank();
+    }
+
+    void teardown() {
+        restore_image();
     }
 };
 // clang-format on
@@ -79,17 +130,49 @@ TEST(File__system__initialization,
   CHECK_EQUAL(FS_Status_Ok, status);
 }
 
+TEST(File__system__initialization,
+     Mapped__image__is__used__without__being__modified) {
+  const char *image_path = "./generated_images/img01.bin";
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  uint8_t test_data[16];
+  size_t file_size = 0;
+  memset(test_data, 0x42, sizeof(test_data));
+
+  bool mapped = FAKE_MEMORY_IO_map_image(image_path, 0,
+                                         FAKE_MEMORY_IO_Image_Private);
+  CHECK_TRUE(mapped);
+  FS_init();
+
+  FS_Status_t status =
+      FS_get_file_size(directory_path, file_name, &file_size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  status = FS_save_to_file(directory_path, "new_file.bin", test_data,
+                           sizeof(test_data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  FS_deinit();
+  FAKE_MEMORY_IO_map_image(image_path, 0, FAKE_MEMORY_IO_Image_Private);
+  FS_init();
+
+  status = FS_get_file_size(directory_path, "new_file.bin", &file_size);
+  CHECK_EQUAL(FS_Status_File_Does_Not_Exist, status);
+
+  FS_deinit();
+  FAKE_MEMORY_IO_unmap_image();
+}
+
 // clang-format off
 TEST_GROUP(File__system__management)
 {
     void setup() {
-        memset(memory_buffer, 0xFF, sizeof(memory_buffer));
-        FAKE_MEMORY_IO_set_buffer(memory_buffer);
+        start_formatted();
         FS_init();
     }
 
     void teardown() {
         FS_deinit();
+        restore_image();
     }
 };
 // clang-format on
@@ -264,6 +347,1281 @@ TEST(File__system__management, Get__data__from__existing__file) {
   }
 }
 
+TEST(File__system__management,
+     Consecutive__programs__are__batched__into__fewer__transfers) {
+  const char *directory_path = "/tmp/test_folder";
+  uint8_t test_data[100];
+  char file_name[16];
+
+  memset(test_data, 0x42, sizeof(test_data));
+  FS_create_folder(directory_path);
+  FAKE_MEMORY_IO_reset_stats();
+
+  for (int i = 0; i < 30; i++) {
+    snprintf(file_name, sizeof(file_name), "file_%d.bin", i);
+    FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+  }
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  CHECK(stats.prog_transfers < stats.prog_extents);
+
+  size_t file_size = 0;
+  FS_Status_t status =
+      FS_get_file_size(directory_path, "file_29.bin", &file_size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  CHECK_EQUAL(sizeof(test_data), file_size);
+}
+
+TEST(File__system__management, Erasing__blank__blocks__is__avoided) {
+  const char *directory_path = "/tmp/test_folder";
+  uint8_t test_data[100];
+  char file_name[16];
+
+  memset(test_data, 0x42, sizeof(test_data));
+  FS_create_folder(directory_path);
+
+  for (int i = 0; i < 10; i++) {
+    snprintf(file_name, sizeof(file_name), "file_%d.bin", i);
+    FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+  }
+
+  FS_Stats_t stats;
+  FS_Status_t status = FS_get_stats(&stats);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  CHECK(stats.erases_avoided > 0U);
+  CHECK(stats.erases_avoided <= stats.erases_requested);
+}
+
+TEST(File__system__management, Program__validation__is__done__on__device) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  uint8_t test_data[3000];
+
+  for (size_t i = 0U; i < sizeof(test_data); i++) {
+    test_data[i] = (uint8_t)(i * 13U);
+  }
+
+  FS_create_folder(directory_path);
+  FAKE_MEMORY_IO_reset_stats();
+  FS_Status_t status = FS_save_to_file(directory_path, file_name, test_data,
+                                       sizeof(test_data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  CHECK(stats.compares > 0U);
+
+  uint8_t read_buffer[sizeof(test_data)];
+  status = FS_read_from_file(directory_path, file_name, read_buffer);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  MEMCMP_EQUAL(test_data, read_buffer, sizeof(test_data));
+}
+
+TEST(File__system__management, Latency__is__estimated__by__virtual__clock) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  uint8_t test_data[4096];
+  uint8_t read_buffer[sizeof(test_data)];
+  memset(test_data, 0x42, sizeof(test_data));
+
+  FAKE_MEMORY_IO_Timing_t timing;
+  FAKE_MEMORY_IO_get_timing(&timing);
+  FS_create_folder(directory_path);
+
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+  uint64_t save_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_read_from_file(directory_path, file_name, read_buffer);
+  uint64_t read_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  /* 16 pages of data have to be programmed, at the very least */
+  CHECK(save_ns >= 16U * timing.page_prog_us * 1000U);
+  CHECK(read_ns > 0U);
+  CHECK(read_ns < save_ns / 10U);
+}
+
+/* Models the host work of producing the data lfs programs, e.g. its CRCs
+ * and cache copies, by advancing the virtual clock when the data arrives. */
+static void charge_host_work(FS_Trace_Op_t op, uint32_t address, uint32_t size,
+                             const void *data, void *context) {
+  (void)address;
+  (void)data;
+  if (op == FS_Trace_Prog) {
+    FAKE_MEMORY_IO_advance_virtual_time((uint64_t)size *
+                                        *(const uint32_t *)context);
+  }
+}
+
+TEST(File__system__management, Host__work__overlaps__programs) {
+  static const uint32_t host_byte_ns = 200;
+  uint8_t test_data[128];
+  char file_name[16];
+  memset(test_data, 0x42, sizeof(test_data));
+  FS_create_folder("/tmp/test_folder");
+
+  /* Small files live in the directory's metadata, so the saves end in
+   * multi-page commits and compactions. lfs reads file data back page by
+   * page instead, which leaves it nothing to prepare while a page programs. */
+  FAKE_MEMORY_IO_reset_stats();
+  FS_set_trace(charge_host_work, (void *)&host_byte_ns);
+  for (int i = 0; i < 200; i++) {
+    snprintf(file_name, sizeof(file_name), "file%d.bin", i % 40);
+    FS_Status_t status = FS_save_to_file("/tmp/test_folder", file_name,
+                                         test_data, sizeof(test_data));
+    CHECK_EQUAL(FS_Status_Ok, status);
+  }
+  FS_set_trace(nullptr, nullptr);
+
+  /* While the device programs or erases, the host prepares the next page */
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  char report[96];
+  snprintf(report, sizeof(report), "device busy %llu us, host wait %llu us",
+           (unsigned long long)stats.device_busy_us,
+           (unsigned long long)stats.host_wait_us);
+  UT_PRINT(report);
+  CHECK(stats.page_programs > 200U);
+  CHECK(stats.sector_erases > 0U);
+  CHECK(stats.host_wait_us < stats.device_busy_us);
+}
+
+TEST(File__system__management, Hot__directories__are__looked__up__once) {
+  const char *directories[] = {"/a", "/b", "/c", "/d", "/e"};
+  uint8_t data[16] = {0};
+  char file_name[16];
+  size_t size;
+  FS_Stats_t before;
+  FS_Stats_t after;
+
+  for (int i = 0; i < 5; i++) {
+    FS_create_folder(directories[i]);
+  }
+
+  FS_get_stats(&before);
+  for (int i = 0; i < 10; i++) {
+    snprintf(file_name, sizeof(file_name), "file%d.bin", i);
+    FS_save_to_file("/e", file_name, data, sizeof(data));
+    FS_get_file_size("/e", file_name, &size);
+  }
+  FS_get_stats(&after);
+  UNSIGNED_LONGS_EQUAL(before.path_cache_misses, after.path_cache_misses);
+  UNSIGNED_LONGS_EQUAL(20, after.path_cache_hits - before.path_cache_hits);
+
+  /* Only the four most recently used directories are kept */
+  FS_get_file_size("/a", "file0.bin", &size);
+  FS_get_stats(&after);
+  UNSIGNED_LONGS_EQUAL(before.path_cache_misses + 1, after.path_cache_misses);
+  FS_get_file_size("/e", "file0.bin", &size);
+  FS_get_stats(&before);
+  UNSIGNED_LONGS_EQUAL(after.path_cache_misses, before.path_cache_misses);
+}
+
+/* The root directory is the first metadata pair lfs writes on format. */
+static void count_root_reads(FS_Trace_Op_t op, uint32_t address, uint32_t size,
+                             const void *data, void *context) {
+  (void)size;
+  (void)data;
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  if (op == FS_Trace_Read && address < 2U * geometry.sector_size) {
+    (*(uint32_t *)context)++;
+  }
+}
+
+TEST(File__system__management, Cached__directories__are__not__walked) {
+  static uint32_t root_reads = 0;
+  uint8_t data[16] = {0};
+  size_t size;
+
+  FS_create_folder("/a/b/c");
+  FS_save_to_file("/a/b/c", "file.bin", data, sizeof(data));
+  FS_deinit();
+  FS_init();
+
+  /* The first lookup walks the path from the root */
+  FS_set_trace(count_root_reads, &root_reads);
+  FS_Status_t status = FS_get_file_size("/a/b/c", "file.bin", &size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  CHECK(root_reads > 0U);
+
+  /* Later ones start from the cached pair of the directory */
+  root_reads = 0;
+  status = FS_get_file_size("/a/b/c", "file.bin", &size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(16, size);
+  status = FS_get_file_size("/a/b/c/", "file.bin", &size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(0, root_reads);
+  FS_set_trace(nullptr, nullptr);
+}
+
+TEST(File__system__management, Saves__keep__directories__cached) {
+  static uint8_t data[4 * 4096];
+  char file_name[16];
+  size_t size;
+  FS_Stats_t before;
+  FS_Stats_t after;
+  memset(data, 0x42, sizeof(data));
+
+  /* Start from a programmed memory, so lfs erases every block it allocates */
+  FS_deinit();
+  memset(memory_buffer, 0x00, sizeof(memory_buffer));
+  memory_image = nullptr;
+  FS_init();
+  FS_create_folder("/logs");
+
+  FS_get_stats(&before);
+  for (int i = 0; i < 4; i++) {
+    snprintf(file_name, sizeof(file_name), "file%d.bin", i);
+    FS_Status_t status = FS_save_to_file("/logs", file_name, data,
+                                         sizeof(data));
+    CHECK_EQUAL(FS_Status_Ok, status);
+    status = FS_get_file_size("/logs", file_name, &size);
+    CHECK_EQUAL(FS_Status_Ok, status);
+    UNSIGNED_LONGS_EQUAL(sizeof(data), size);
+  }
+  FS_get_stats(&after);
+
+  /* Erasing file data does not move the directory, which stays cached from
+   * its creation */
+  CHECK(after.erases_requested - after.erases_avoided >
+        before.erases_requested - before.erases_avoided);
+  UNSIGNED_LONGS_EQUAL(before.path_cache_misses, after.path_cache_misses);
+  UNSIGNED_LONGS_EQUAL(8, after.path_cache_hits - before.path_cache_hits);
+}
+
+/* Remembers the last block programmed and how many times the block changed,
+ * to find the metadata pair a directory is committed to. */
+typedef struct {
+  uint32_t block;
+  uint32_t changes;
+} Prog_Blocks_t;
+
+static void track_prog_blocks(FS_Trace_Op_t op, uint32_t address,
+                              uint32_t size, const void *data,
+                              void *context) {
+  (void)size;
+  (void)data;
+  Prog_Blocks_t *blocks = (Prog_Blocks_t *)context;
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  if (op == FS_Trace_Prog && address / geometry.sector_size != blocks->block) {
+    blocks->block = address / geometry.sector_size;
+    blocks->changes++;
+  }
+}
+
+typedef struct {
+  uint32_t address;
+  uint32_t reads;
+} Block_Reads_t;
+
+static void count_block_reads(FS_Trace_Op_t op, uint32_t address,
+                              uint32_t size, const void *data,
+                              void *context) {
+  (void)size;
+  (void)data;
+  Block_Reads_t *block = (Block_Reads_t *)context;
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  if (op == FS_Trace_Read && address - block->address < geometry.sector_size) {
+    block->reads++;
+  }
+}
+
+TEST(File__system__management, Relocated__directories__stay__cached) {
+  static Prog_Blocks_t blocks = {UINT32_MAX, 0};
+  uint8_t data[16] = {0};
+  size_t size;
+  MEMIO_Geometry_t geometry;
+  MEMIO_get_geometry(&geometry);
+  FS_create_folder("/d");
+
+  /* Rewrite an inline file until the directory is compacted into the other
+   * block of its pair */
+  FS_set_trace(track_prog_blocks, &blocks);
+  FS_save_to_file("/d", "file.bin", data, sizeof(data));
+  uint32_t first = blocks.block;
+  for (int i = 0; i < 500 && blocks.block == first; i++) {
+    FS_save_to_file("/d", "file.bin", data, sizeof(data));
+  }
+  FS_set_trace(nullptr, nullptr);
+  uint32_t active = blocks.block * geometry.sector_size;
+  uint32_t other = first * geometry.sector_size;
+  CHECK(active != other);
+
+  /* Bits stuck programmed after the last commit make lfs compact the
+   * directory, and bits stuck against the first tag make the compaction into
+   * the other block fail, so the directory is relocated */
+  uint32_t end = active + geometry.sector_size;
+  while (end > active && memory_buffer[end - 1U] == 0xFF) {
+    end--;
+  }
+  uint32_t next = (end + geometry.page_size - 1U) / geometry.page_size *
+                  geometry.page_size;
+  for (uint32_t i = 0; i < 4U; i++) {
+    CHECK_TRUE(FAKE_MEMORY_IO_add_stuck_bit(end + i, 0, false));
+    CHECK_TRUE(FAKE_MEMORY_IO_add_stuck_bit(next + i, 0, false));
+  }
+  for (uint8_t bit = 0; bit < 8U; bit++) {
+    bool value = (memory_buffer[active + 4U] & (1U << bit)) == 0U;
+    CHECK_TRUE(FAKE_MEMORY_IO_add_stuck_bit(other + 4U, bit, value));
+  }
+
+  FS_Stats_t before;
+  FS_Stats_t after;
+  FS_get_stats(&before);
+  FS_Status_t status = FS_save_to_file("/d", "after.bin", data, sizeof(data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  /* The cached pair follows the directory, so the block lfs dropped from the
+   * pair is not read anymore */
+  static Block_Reads_t dropped = {0, 0};
+  dropped.address = other;
+  FS_set_trace(count_block_reads, &dropped);
+  status = FS_get_file_size("/d", "after.bin", &size);
+  FS_set_trace(nullptr, nullptr);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(sizeof(data), size);
+  UNSIGNED_LONGS_EQUAL(0, dropped.reads);
+  FS_get_stats(&after);
+  UNSIGNED_LONGS_EQUAL(before.path_cache_misses, after.path_cache_misses);
+}
+
+TEST(File__system__management, Directory__is__listed__with__a__cursor) {
+  static FS_Dir_Entry_t entries[4];
+  FS_Dir_Cursor_t cursor = {0, false};
+  uint8_t data[100] = {0};
+  char file_name[16];
+  size_t count = 0;
+  int files_seen = 0;
+  int folders_seen = 0;
+  int calls = 0;
+
+  FS_create_folder("/logs/archive");
+  for (int i = 0; i < 10; i++) {
+    snprintf(file_name, sizeof(file_name), "log%d.txt", i);
+    FS_save_to_file("/logs", file_name, data, (size_t)i * 10U);
+  }
+
+  while (!cursor.end) {
+    FS_Status_t status = FS_list_dir("/logs", entries, 4, &cursor, &count);
+    CHECK_EQUAL(FS_Status_Ok, status);
+    CHECK(count <= 4U);
+    for (size_t i = 0; i < count; i++) {
+      if (entries[i].type == FS_Entry_Folder) {
+        STRCMP_EQUAL("archive", entries[i].name);
+        folders_seen++;
+      } else {
+        int index = entries[i].name[3] - '0';
+        snprintf(file_name, sizeof(file_name), "log%d.txt", index);
+        STRCMP_EQUAL(file_name, entries[i].name);
+        UNSIGNED_LONGS_EQUAL(index * 10, entries[i].size);
+        files_seen++;
+      }
+    }
+    calls++;
+    CHECK(calls < 10);
+  }
+
+  LONGS_EQUAL(10, files_seen);
+  LONGS_EQUAL(1, folders_seen);
+  cursor.position = 0;
+  cursor.end = false;
+  CHECK_EQUAL(FS_Status_Folder_Does_Not_Exist,
+              FS_list_dir("/missing", entries, 4, &cursor, &count));
+}
+
+static uint32_t save_configs(bool in_transaction, uint8_t value) {
+  const char *names[] = {"a.cfg", "b.cfg", "c.cfg", "d.cfg"};
+  uint8_t data[64];
+  FAKE_MEMORY_IO_Stats_t stats;
+
+  memset(data, value, sizeof(data));
+  FAKE_MEMORY_IO_reset_stats();
+  if (in_transaction) {
+    CHECK_EQUAL(FS_Status_Ok, FS_txn_begin());
+  }
+  for (int i = 0; i < 4; i++) {
+    FS_Status_t status =
+        in_transaction
+            ? FS_txn_write("/config", names[i], data, sizeof(data))
+            : FS_save_to_file("/config", names[i], data,
+                              sizeof(data));
+    CHECK_EQUAL(FS_Status_Ok, status);
+  }
+  if (in_transaction) {
+    CHECK_EQUAL(FS_Status_Ok, FS_txn_commit());
+  }
+  FAKE_MEMORY_IO_get_stats(&stats);
+  return stats.page_programs;
+}
+
+TEST(File__system__management, Transaction__commits__files__together) {
+  uint8_t expected[64];
+  uint8_t read_buffer[64];
+  size_t size;
+
+  FS_create_folder("/config");
+  save_configs(false, 0x11);
+  uint32_t saved_programs = save_configs(false, 0x22);
+  uint32_t committed_programs = save_configs(true, 0x33);
+  CHECK(committed_programs * 2U <= saved_programs);
+
+  memset(expected, 0x33, sizeof(expected));
+  FS_read_from_file("/config", "d.cfg", read_buffer);
+  MEMCMP_EQUAL(expected, read_buffer, sizeof(read_buffer));
+
+  /* Files of different directories are committed through the journal, whose
+   * folder is reserved and removed afterwards. User files named like the
+   * temporary files of other designs are left alone. */
+  FS_create_folder("/other");
+  FS_save_to_file("/config", "a.cfg.txn", read_buffer, 1);
+  CHECK_EQUAL(FS_Status_Err, FS_create_folder("/.txn"));
+  memset(expected, 0x44, sizeof(expected));
+  FS_txn_begin();
+  FS_txn_write("/config", "a.cfg", expected, sizeof(expected));
+  FS_txn_write("/other", "a.cfg", expected, sizeof(expected));
+  CHECK_EQUAL(FS_Status_Ok, FS_txn_commit());
+  FS_read_from_file("/other", "a.cfg", read_buffer);
+  MEMCMP_EQUAL(expected, read_buffer, sizeof(read_buffer));
+  CHECK_EQUAL(FS_Status_Ok, FS_get_file_size("/config", "a.cfg.txn", &size));
+  LONGS_EQUAL(1, size);
+  CHECK_EQUAL(FS_Status_Folder_Does_Not_Exist,
+              FS_get_file_size("/.txn", "journal", &size));
+
+  /* Aborted transactions leave the files untouched */
+  FS_txn_begin();
+  FS_txn_write("/config", "a.cfg", read_buffer, 1);
+  CHECK_EQUAL(FS_Status_Err, FS_txn_begin());
+  CHECK_EQUAL(FS_Status_Ok, FS_txn_abort());
+  FS_read_from_file("/config", "a.cfg", read_buffer);
+  MEMCMP_EQUAL(expected, read_buffer, sizeof(read_buffer));
+  CHECK_EQUAL(FS_Status_Err, FS_txn_commit());
+}
+
+TEST(File__system__management, Transaction__spans__a__split__directory) {
+  uint8_t data[8];
+  uint8_t read_buffer[sizeof(data)];
+  char file_name[48];
+
+  /* Enough entries for the directory to span several metadata pairs */
+  FS_create_folder("/cfg");
+  memset(data, 0x11, sizeof(data));
+  for (int i = 0; i < 200; i++) {
+    snprintf(file_name, sizeof(file_name), "configuration_entry_%03d.cfg", i);
+    FS_save_to_file("/cfg", file_name, data, sizeof(data));
+  }
+
+  memset(data, 0x22, sizeof(data));
+  FS_txn_begin();
+  FS_txn_write("/cfg", "configuration_entry_000.cfg", data, sizeof(data));
+  FS_txn_write("/cfg", "configuration_entry_199.cfg", data, sizeof(data));
+  CHECK_EQUAL(FS_Status_Ok, FS_txn_commit());
+
+  FS_read_from_file("/cfg", "configuration_entry_000.cfg", read_buffer);
+  MEMCMP_EQUAL(data, read_buffer, sizeof(data));
+  FS_read_from_file("/cfg", "configuration_entry_199.cfg", read_buffer);
+  MEMCMP_EQUAL(data, read_buffer, sizeof(data));
+}
+
+TEST(File__system__management, Rewrites__spread__erases__over__sectors) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  const uint32_t rewrites = 200;
+  uint8_t test_data[1000];
+
+  FS_create_folder(directory_path);
+  FAKE_MEMORY_IO_reset_wear();
+  for (uint32_t i = 0; i < rewrites; i++) {
+    memset(test_data, (int)i, sizeof(test_data));
+    FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+  }
+
+  FAKE_MEMORY_IO_Wear_Report_t report;
+  FAKE_MEMORY_IO_get_wear_report(100000, &report);
+  CHECK(report.max_erases > 0U);
+  CHECK(report.max_erases < rewrites / 4U);
+}
+
+TEST(File__system__management, Data__is__kept__when__device__is__slow) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  uint8_t test_data[1500];
+
+  for (size_t i = 0U; i < sizeof(test_data); i++) {
+    test_data[i] = (uint8_t)(i * 7U);
+  }
+
+  FAKE_MEMORY_IO_set_busy_time(100, 500);
+
+  FS_create_folder(directory_path);
+  FS_Status_t status = FS_save_to_file(directory_path, file_name, test_data,
+                                       sizeof(test_data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  uint8_t read_buffer[sizeof(test_data)];
+  memset(read_buffer, 0, sizeof(read_buffer));
+  status = FS_read_from_file(directory_path, file_name, read_buffer);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  MEMCMP_EQUAL(test_data, read_buffer, sizeof(test_data));
+
+  FAKE_MEMORY_IO_set_busy_time(0, 0);
+}
+
+TEST(File__system__management, Map__file__returns__its__data__in__place) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "lookup_table.bin";
+  static uint8_t test_data[10000];
+
+  for (size_t i = 0U; i < sizeof(test_data); i++) {
+    test_data[i] = (uint8_t)(i * 13U);
+  }
+
+  FS_create_folder(directory_path);
+  FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+
+  size_t offset = 0U;
+  size_t extents = 0U;
+  while (offset < sizeof(test_data)) {
+    const uint8_t *data = nullptr;
+    size_t size = 0U;
+    FS_Status_t status =
+        FS_map_file(directory_path, file_name, offset, &data, &size);
+    CHECK_EQUAL(FS_Status_Ok, status);
+    CHECK(size > 0U && size <= 4096U);
+    CHECK(data >= memory_buffer &&
+          data < memory_buffer + sizeof(memory_buffer));
+    MEMCMP_EQUAL(&test_data[offset], data, size);
+    offset += size;
+    extents++;
+  }
+
+  CHECK_EQUAL(sizeof(test_data), offset);
+  CHECK(extents >= 3U);
+}
+
+TEST(File__system__management,
+     Map__file__is__not__supported__for__inline__files) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "small_file.bin";
+  const uint8_t test_data[16] = {1, 2, 3};
+  const uint8_t *data = nullptr;
+  size_t size = 0U;
+
+  FS_create_folder(directory_path);
+  FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+
+  FS_Status_t status = FS_map_file(directory_path, file_name, 0, &data, &size);
+  CHECK_EQUAL(FS_Status_Not_Supported, status);
+
+  status = FS_map_file(directory_path, "missing.bin", 0, &data, &size);
+  CHECK_EQUAL(FS_Status_File_Does_Not_Exist, status);
+}
+
+// clang-format off
+TEST_GROUP(File__system__streaming)
+{
+    void setup() {
+        start_formatted();
+        FS_init();
+        FS_create_folder("/tmp/test_folder");
+    }
+
+    void teardown() {
+        FS_deinit();
+        restore_image();
+    }
+};
+// clang-format on
+
+TEST(File__system__streaming, Large__file__is__streamed__in__chunks) {
+  const size_t file_size = 300 * 1024;
+  uint8_t chunk[512];
+  FS_File_t *file = NULL;
+  size_t size = 0;
+
+  for (size_t i = 0; i < file_size; i++) {
+    large_file_data[i] = (uint8_t)(i * 31U + (i >> 9));
+  }
+
+  FS_Status_t status =
+      FS_open("/tmp/test_folder", "stream.bin",
+              FS_Open_Write | FS_Open_Create | FS_Open_Truncate, &file);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  for (size_t offset = 0; offset < file_size; offset += sizeof(chunk)) {
+    status = FS_write(file, &large_file_data[offset], sizeof(chunk));
+    CHECK_EQUAL(FS_Status_Ok, status);
+  }
+  CHECK_EQUAL(FS_Status_Ok, FS_close(file));
+
+  FS_get_file_size("/tmp/test_folder", "stream.bin", &size);
+  UNSIGNED_LONGS_EQUAL(file_size, size);
+
+  status = FS_open("/tmp/test_folder", "stream.bin", FS_Open_Read, &file);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  for (size_t offset = 0; offset < file_size; offset += size) {
+    status = FS_read(file, chunk, sizeof(chunk), &size);
+    CHECK_EQUAL(FS_Status_Ok, status);
+    UNSIGNED_LONGS_EQUAL(sizeof(chunk), size);
+    MEMCMP_EQUAL(&large_file_data[offset], chunk, sizeof(chunk));
+  }
+  status = FS_read(file, chunk, sizeof(chunk), &size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(0, size);
+  CHECK_EQUAL(FS_Status_Ok, FS_close(file));
+}
+
+TEST(File__system__streaming, Handles__come__from__a__fixed__pool) {
+  FS_File_t *files[4];
+  FS_File_t *extra = NULL;
+  char name[16];
+  uint8_t byte;
+  size_t size;
+
+  for (int i = 0; i < 4; i++) {
+    snprintf(name, sizeof(name), "file%d.bin", i);
+    FS_Status_t status = FS_open("/tmp/test_folder", name,
+                                 FS_Open_Write | FS_Open_Create, &files[i]);
+    CHECK_EQUAL(FS_Status_Ok, status);
+  }
+  CHECK_EQUAL(FS_Status_Too_Many_Open_Files,
+              FS_open("/tmp/test_folder", "extra.bin",
+                      FS_Open_Write | FS_Open_Create, &extra));
+
+  for (int i = 0; i < 4; i++) {
+    byte = (uint8_t)i;
+    CHECK_EQUAL(FS_Status_Ok, FS_write(files[i], &byte, 1));
+    CHECK_EQUAL(FS_Status_Ok, FS_close(files[i]));
+  }
+  CHECK_EQUAL(FS_Status_Err, FS_close(files[0]));
+
+  CHECK_EQUAL(FS_Status_Ok,
+              FS_open("/tmp/test_folder", "file2.bin", FS_Open_Read, &extra));
+  CHECK_EQUAL(FS_Status_Ok, FS_read(extra, &byte, 1, &size));
+  UNSIGNED_LONGS_EQUAL(1, size);
+  UNSIGNED_LONGS_EQUAL(2, byte);
+  CHECK_EQUAL(FS_Status_Ok, FS_close(extra));
+
+  CHECK_EQUAL(FS_Status_File_Does_Not_Exist,
+              FS_open("/tmp/test_folder", "missing.bin", FS_Open_Read, &extra));
+  CHECK_EQUAL(FS_Status_Folder_Does_Not_Exist,
+              FS_open("/missing", "file2.bin", FS_Open_Read, &extra));
+}
+
+TEST(File__system__streaming, Seek__moves__within__the__file) {
+  const uint8_t data[] = "0123456789";
+  FS_File_t *file = NULL;
+  uint8_t read_buffer[4];
+  size_t position;
+  size_t size;
+
+  FS_open("/tmp/test_folder", "seek.bin",
+          FS_Open_Read | FS_Open_Write | FS_Open_Create, &file);
+  FS_write(file, data, 10);
+  CHECK_EQUAL(FS_Status_Ok, FS_sync(file));
+
+  CHECK_EQUAL(FS_Status_Ok, FS_seek(file, 3, FS_Seek_Set, &position));
+  UNSIGNED_LONGS_EQUAL(3, position);
+  FS_read(file, read_buffer, sizeof(read_buffer), &size);
+  MEMCMP_EQUAL("3456", read_buffer, sizeof(read_buffer));
+
+  CHECK_EQUAL(FS_Status_Ok, FS_seek(file, -2, FS_Seek_End, &position));
+  UNSIGNED_LONGS_EQUAL(8, position);
+  FS_write(file, (const uint8_t *)"AB", 2);
+  CHECK_EQUAL(FS_Status_Ok, FS_seek(file, -4, FS_Seek_Cur, &position));
+  FS_read(file, read_buffer, sizeof(read_buffer), &size);
+  MEMCMP_EQUAL("67AB", read_buffer, sizeof(read_buffer));
+
+  CHECK_EQUAL(FS_Status_Err, FS_seek(file, -1, FS_Seek_Set, NULL));
+  FS_close(file);
+}
+
+TEST(File__system__streaming, Range__read__costs__the__range__only) {
+  const size_t file_size = 200 * 1024;
+  uint8_t header[64];
+  size_t size = 0;
+
+  for (size_t i = 0; i < file_size; i++) {
+    large_file_data[i] = (uint8_t)(i * 7U + (i >> 8));
+  }
+  FS_save_to_file("/tmp/test_folder", "records.bin", large_file_data,
+                  file_size);
+
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_read_from_file("/tmp/test_folder", "records.bin",
+                    &large_file_data[file_size]);
+  uint64_t whole_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_Status_t status =
+      FS_read_range("/tmp/test_folder", "records.bin", 150 * 1024,
+                    sizeof(header), header, &size);
+  uint64_t range_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(sizeof(header), size);
+  MEMCMP_EQUAL(&large_file_data[150 * 1024], header, sizeof(header));
+  CHECK(range_ns < whole_ns / 20U);
+
+  status = FS_read_range("/tmp/test_folder", "records.bin", file_size - 10,
+                         sizeof(header), header, &size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(10, size);
+  if (sizeof(size_t) > sizeof(uint32_t)) {
+    /* A length wider than 32 bits is clamped to the file, not truncated */
+    status = FS_read_range("/tmp/test_folder", "records.bin", file_size - 10,
+                           (size_t)UINT32_MAX + 5U, header, &size);
+    CHECK_EQUAL(FS_Status_Ok, status);
+    UNSIGNED_LONGS_EQUAL(10, size);
+  }
+  CHECK_EQUAL(FS_Status_Err,
+              FS_read_range("/tmp/test_folder", "records.bin", file_size + 1,
+                            sizeof(header), header, &size));
+  CHECK_EQUAL(FS_Status_File_Does_Not_Exist,
+              FS_read_range("/tmp/test_folder", "missing.bin", 0,
+                            sizeof(header), header, &size));
+  CHECK_EQUAL(FS_Status_Folder_Does_Not_Exist,
+              FS_read_range("/missing", "records.bin", 0, sizeof(header),
+                            header, &size));
+}
+
+// clang-format off
+TEST_GROUP(File__system__append)
+{
+    void setup() {
+        start_formatted();
+        FS_init();
+        FS_create_folder("/tmp/test_folder");
+    }
+
+    void teardown() {
+        FS_set_append_threshold(256);
+        FS_deinit();
+        restore_image();
+    }
+};
+// clang-format on
+
+static uint32_t append_records(const char *file_name, uint32_t count) {
+  uint8_t record[16];
+  FAKE_MEMORY_IO_Stats_t stats;
+
+  FAKE_MEMORY_IO_reset_stats();
+  for (uint32_t i = 0; i < count; i++) {
+    memset(record, (int)i, sizeof(record));
+    FS_Status_t status = FS_append_to_file("/tmp/test_folder", file_name,
+                                           record, sizeof(record));
+    CHECK_EQUAL(FS_Status_Ok, status);
+  }
+  CHECK_EQUAL(FS_Status_Ok, FS_flush_appends());
+  FAKE_MEMORY_IO_get_stats(&stats);
+  return stats.page_programs;
+}
+
+TEST(File__system__append, Append__costs__the__bytes__written) {
+  const size_t log_size = 64 * 1024;
+  uint8_t record[32];
+  uint8_t tail[sizeof(record)];
+  size_t size = 0;
+  memset(large_file_data, 0x3C, log_size);
+  memset(record, 0xC3, sizeof(record));
+  FS_set_append_threshold(0);
+
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_save_to_file("/tmp/test_folder", "log.bin", large_file_data, log_size);
+  uint64_t save_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_Status_t status = FS_append_to_file("/tmp/test_folder", "log.bin",
+                                         record, sizeof(record));
+  uint64_t append_ns = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+  CHECK_EQUAL(FS_Status_Ok, status);
+  CHECK(append_ns < save_ns / 10U);
+  FS_get_file_size("/tmp/test_folder", "log.bin", &size);
+  UNSIGNED_LONGS_EQUAL(log_size + sizeof(record), size);
+  FS_read_range("/tmp/test_folder", "log.bin", log_size, sizeof(tail), tail,
+                &size);
+  MEMCMP_EQUAL(record, tail, sizeof(tail));
+}
+
+TEST(File__system__append, Small__appends__are__batched) {
+  uint8_t record[16];
+  size_t size = 0;
+
+  FS_set_append_threshold(0);
+  uint32_t unbatched_programs = append_records("unbatched.log", 64);
+  FS_set_append_threshold(256);
+  uint32_t batched_programs = append_records("batched.log", 64);
+
+  CHECK(batched_programs * 4U < unbatched_programs);
+  FS_read_from_file("/tmp/test_folder", "batched.log", large_file_data);
+  for (uint32_t i = 0; i < 64; i++) {
+    memset(record, (int)i, sizeof(record));
+    MEMCMP_EQUAL(record, &large_file_data[i * sizeof(record)], sizeof(record));
+  }
+
+  /* Collected appends are written before the file is looked at */
+  FS_append_to_file("/tmp/test_folder", "batched.log", record, sizeof(record));
+  FS_get_file_size("/tmp/test_folder", "batched.log", &size);
+  UNSIGNED_LONGS_EQUAL(65 * sizeof(record), size);
+  CHECK_EQUAL(FS_Status_Folder_Does_Not_Exist,
+              FS_append_to_file("/missing", "batched.log", record,
+                                sizeof(record)));
+}
+
+// clang-format off
+TEST_GROUP(File__system__geometry)
+{
+    void setup() {
+        memset(large_memory_buffer, 0xFF, sizeof(large_memory_buffer));
+        FAKE_MEMORY_IO_set_buffer(large_memory_buffer);
+    }
+};
+// clang-format on
+
+TEST(File__system__geometry, File__larger__than__2MiB__fits__on__8MiB__device) {
+  FS_Status_t status;
+  const char *directory_path = "/data";
+  const char *file_name = "large_file.bin";
+  const MEMIO_Geometry_t geometry = {
+      0xC84017, sizeof(large_memory_buffer), 256, 4096, 64 * 1024,
+  };
+
+  for (size_t i = 0U; i < sizeof(large_file_data); i++) {
+    large_file_data[i] = (uint8_t)(i ^ (i >> 8));
+  }
+
+  FAKE_MEMORY_IO_set_geometry(&geometry);
+  status = FS_init();
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  FS_create_folder(directory_path);
+  status = FS_save_to_file(directory_path, file_name, large_file_data,
+                           sizeof(large_file_data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  size_t file_size = 0;
+  status = FS_get_file_size(directory_path, file_name, &file_size);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  CHECK_EQUAL(sizeof(large_file_data), file_size);
+
+  status = FS_deinit();
+  CHECK_EQUAL(FS_Status_Ok, status);
+}
+
+TEST(File__system__geometry, Initialization__fails__with__invalid__geometry) {
+  const MEMIO_Geometry_t geometry = {0, sizeof(large_memory_buffer), 256, 1000,
+                                     64 * 1024};
+
+  FAKE_MEMORY_IO_set_geometry(&geometry);
+  FS_Status_t status = FS_init();
+  CHECK_EQUAL(FS_Status_Err, status);
+}
+
+// clang-format off
+TEST_GROUP(File__system__read__latency)
+{
+    void setup() {
+        FAKE_MEMORY_IO_set_buffer(memory_buffer);
+        load_binary_image("./generated_images/img01.bin");
+        FS_init();
+    }
+
+    void teardown() {
+        MEMIO_wait();
+        FS_deinit();
+    }
+};
+// clang-format on
+
+TEST(File__system__read__latency, Reads__are__not__stuck__behind__erases) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  const uint32_t erase_busy_us = 20000;
+  const uint32_t scratch_address = 511 * 4096; // Unused by img01.bin
+  const size_t reads = 100;
+  uint64_t latencies_ns[reads];
+  uint8_t read_buffer[32];
+
+  FAKE_MEMORY_IO_set_busy_time(500, erase_busy_us);
+  FAKE_MEMORY_IO_set_suspend_time(20, 20);
+
+  for (size_t i = 0U; i < reads; i++) {
+    if (!MEMIO_is_busy()) {
+      MEMIO_erase_async(scratch_address, nullptr, nullptr);
+    }
+
+    uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+    FS_Status_t status =
+        FS_read_from_file(directory_path, file_name, read_buffer);
+    latencies_ns[i] = FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+
+    CHECK_EQUAL(FS_Status_Ok, status);
+    /* The application works between reads, while the erase goes on */
+    FAKE_MEMORY_IO_advance_virtual_time(erase_busy_us * 1000U / 8U);
+  }
+
+  std::sort(latencies_ns, latencies_ns + reads);
+  uint64_t p99_ns = latencies_ns[(reads * 99U) / 100U - 1U];
+  CHECK(p99_ns < erase_busy_us * 1000U / 2U);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  CHECK(stats.suspends > 0U);
+}
+
+static const char *power_loss_folder = "/tmp/test_folder";
+static uint8_t power_loss_data[2][600];
+
+static void power_loss_workload(void) {
+  FS_init();
+  FS_save_to_file(power_loss_folder, "data.bin", power_loss_data[0],
+                  sizeof(power_loss_data[0]));
+  FS_save_to_file(power_loss_folder, "data.bin", power_loss_data[1],
+                  sizeof(power_loss_data[1]));
+  FS_deinit();
+}
+
+/* The untouched file must survive. data.bin is missing, empty as lfs creates
+ * it on open, or holds one of the versions written in full. */
+static bool power_loss_check(void) {
+  uint8_t read_buffer[sizeof(power_loss_data[0])];
+  size_t file_size = 0;
+  bool valid = (FS_init() == FS_Status_Ok) &&
+               (FS_read_from_file(power_loss_folder, "test_file.bin",
+                                  read_buffer) == FS_Status_Ok) &&
+               (strcmp("Hello, World!", (const char *)read_buffer) == 0);
+
+  FS_Status_t status =
+      FS_get_file_size(power_loss_folder, "data.bin", &file_size);
+  if (status != FS_Status_Ok) {
+    valid = valid && (status == FS_Status_File_Does_Not_Exist);
+  } else if (file_size > 0U) {
+    valid = valid && (file_size == sizeof(read_buffer)) &&
+            (FS_read_from_file(power_loss_folder, "data.bin", read_buffer) ==
+             FS_Status_Ok) &&
+            (memcmp(read_buffer, power_loss_data[0], file_size) == 0 ||
+             memcmp(read_buffer, power_loss_data[1], file_size) == 0);
+  }
+
+  FS_deinit();
+  return valid;
+}
+
+// clang-format off
+TEST_GROUP(File__system__power__loss)
+{
+    void setup() {
+        memset(power_loss_data[0], 0xA5, sizeof(power_loss_data[0]));
+        memset(power_loss_data[1], 0x5A, sizeof(power_loss_data[1]));
+        load_binary_image("./generated_images/img01.bin");
+        memcpy(power_loss_image, memory_buffer, sizeof(power_loss_image));
+    }
+
+    void teardown() {
+        FAKE_MEMORY_IO_set_buffer(memory_buffer);
+    }
+};
+// clang-format on
+
+TEST(File__system__power__loss, Clean__cuts__never__corrupt__files) {
+  POWER_LOSS_Result_t result;
+  bool ran = POWER_LOSS_sweep(memory_buffer, power_loss_image,
+                              sizeof(power_loss_image),
+                              FAKE_MEMORY_IO_Cut_Clean, power_loss_workload,
+                              power_loss_check, 0, &result);
+  CHECK_TRUE(ran);
+  CHECK(result.cut_points > 0U);
+  UNSIGNED_LONGS_EQUAL(0, result.failures);
+}
+
+TEST(File__system__power__loss, Partial__cuts__never__corrupt__files) {
+  POWER_LOSS_Result_t result;
+  bool ran = POWER_LOSS_sweep(memory_buffer, power_loss_image,
+                              sizeof(power_loss_image),
+                              FAKE_MEMORY_IO_Cut_Partial, power_loss_workload,
+                              power_loss_check, 0, &result);
+  CHECK_TRUE(ran);
+  CHECK(result.cut_points > 0U);
+  UNSIGNED_LONGS_EQUAL(0, result.failures);
+}
+
+/* Folders of a.cfg and b.cfg; b.cfg sits elsewhere for the journal */
+static const char *transaction_folders[2];
+
+static void transaction_workload(void) {
+  FS_init();
+  FS_txn_begin();
+  FS_txn_write(transaction_folders[0], "a.cfg", power_loss_data[1],
+               sizeof(power_loss_data[1]));
+  FS_txn_write(transaction_folders[1], "b.cfg", power_loss_data[1],
+               sizeof(power_loss_data[1]));
+  FS_txn_commit();
+  FS_deinit();
+}
+
+/* Both files hold the same version, whole, and nothing staged is left. */
+static bool transaction_check(void) {
+  uint8_t read_buffer[2][sizeof(power_loss_data[0])];
+  size_t size;
+  bool valid =
+      (FS_init() == FS_Status_Ok) &&
+      (FS_get_file_size("/.txn", "0", &size) ==
+       FS_Status_Folder_Does_Not_Exist) &&
+      (FS_read_from_file(transaction_folders[0], "a.cfg", read_buffer[0]) ==
+       FS_Status_Ok) &&
+      (FS_read_from_file(transaction_folders[1], "b.cfg", read_buffer[1]) ==
+       FS_Status_Ok) &&
+      (memcmp(read_buffer[0], read_buffer[1], sizeof(read_buffer[0])) == 0) &&
+      (memcmp(read_buffer[0], power_loss_data[0], sizeof(read_buffer[0])) ==
+           0 ||
+       memcmp(read_buffer[0], power_loss_data[1], sizeof(read_buffer[0])) ==
+           0);
+
+  FS_deinit();
+  return valid;
+}
+
+static void sweep_transaction(const char *folder_a, const char *folder_b) {
+  POWER_LOSS_Result_t result;
+  transaction_folders[0] = folder_a;
+  transaction_folders[1] = folder_b;
+  FS_init();
+  FS_create_folder(folder_b);
+  FS_save_to_file(folder_a, "a.cfg", power_loss_data[0],
+                  sizeof(power_loss_data[0]));
+  FS_save_to_file(folder_b, "b.cfg", power_loss_data[0],
+                  sizeof(power_loss_data[0]));
+  FS_deinit();
+  memcpy(power_loss_image, memory_buffer, sizeof(power_loss_image));
+
+  bool ran = POWER_LOSS_sweep(memory_buffer, power_loss_image,
+                              sizeof(power_loss_image),
+                              FAKE_MEMORY_IO_Cut_Partial, transaction_workload,
+                              transaction_check, 0, &result);
+  CHECK_TRUE(ran);
+  CHECK(result.cut_points > 0U);
+  UNSIGNED_LONGS_EQUAL(0, result.failures);
+}
+
+TEST(File__system__power__loss, Transactions__update__all__files__or__none) {
+  sweep_transaction(power_loss_folder, power_loss_folder);
+}
+
+/* Cuts before the journal is committed leave temporary files behind, which
+ * the next mount removes. */
+TEST(File__system__power__loss, Journaled__transactions__are__atomic) {
+  sweep_transaction(power_loss_folder, "/other");
+}
+
+static uint8_t bit_error_data[16 * 1024];
+static uint8_t bit_error_read_buffer[sizeof(bit_error_data)];
+
+// clang-format off
+TEST_GROUP(File__system__bit__errors)
+{
+    FAKE_MEMORY_IO_Errors_t errors;
+
+    void setup() {
+        start_formatted();
+        memset(&errors, 0, sizeof(errors));
+        errors.seed = 7;
+        for (size_t i = 0; i < sizeof(bit_error_data); i++) {
+            bit_error_data[i] = (uint8_t)(i * 13U);
+        }
+        FS_init();
+        FS_create_folder("/tmp/test_folder");
+    }
+
+    void teardown() {
+        FAKE_MEMORY_IO_clear_errors();
+        FS_deinit();
+        restore_image();
+    }
+};
+// clang-format on
+
+static double kib_per_s(uint64_t bytes, uint64_t ns) {
+  return (ns == 0U) ? 0.0 : (double)bytes / 1024.0 / ((double)ns / 1e9);
+}
+
+static uint64_t timed_save(const char *file_name) {
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  FS_Status_t status = FS_save_to_file("/tmp/test_folder", file_name,
+                                       bit_error_data, sizeof(bit_error_data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+  return FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+}
+
+static uint64_t timed_read(const char *file_name, FS_Status_t *status) {
+  uint64_t start_ns = FAKE_MEMORY_IO_get_virtual_time_ns();
+  *status = FS_read_from_file("/tmp/test_folder", file_name,
+                              bit_error_read_buffer);
+  return FAKE_MEMORY_IO_get_virtual_time_ns() - start_ns;
+}
+
+TEST(File__system__bit__errors, Failed__programs__are__relocated) {
+  FS_Status_t status;
+  uint64_t clean_save_ns = timed_save("clean.bin");
+  uint64_t clean_read_ns = timed_read("clean.bin", &status);
+
+  errors.prog_failure_rate = 0.05;
+  FAKE_MEMORY_IO_set_errors(&errors);
+  FAKE_MEMORY_IO_reset_stats();
+  uint64_t faulty_save_ns = timed_save("faulty.bin");
+  FAKE_MEMORY_IO_clear_errors();
+  uint64_t faulty_read_ns = timed_read("faulty.bin", &status);
+
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  char report[160];
+  snprintf(report, sizeof(report),
+           "%u failed programs, save %.0f -> %.0f KiB/s, "
+           "read %.0f -> %.0f KiB/s",
+           (unsigned)stats.bit_flips,
+           kib_per_s(sizeof(bit_error_data), clean_save_ns),
+           kib_per_s(sizeof(bit_error_data), faulty_save_ns),
+           kib_per_s(sizeof(bit_error_data), clean_read_ns),
+           kib_per_s(sizeof(bit_error_data), faulty_read_ns));
+  UT_PRINT(report);
+
+  CHECK_EQUAL(FS_Status_Ok, status);
+  MEMCMP_EQUAL(bit_error_data, bit_error_read_buffer, sizeof(bit_error_data));
+  CHECK(stats.bit_flips > 0U);
+  CHECK(faulty_save_ns > clean_save_ns);
+}
+
+TEST(File__system__bit__errors, Read__errors__degrade__read__throughput) {
+  const double rates[] = {0.0, 1e-7, 1e-6, 1e-5};
+  const int reads = 20;
+  int intact[4] = {0};
+
+  timed_save("data.bin");
+  for (size_t r = 0; r < sizeof(rates) / sizeof(rates[0]); r++) {
+    errors.read_bit_error_rate = rates[r];
+    FAKE_MEMORY_IO_set_errors(&errors);
+    FAKE_MEMORY_IO_reset_stats();
+
+    uint64_t total_ns = 0;
+    int failed = 0;
+    for (int i = 0; i < reads; i++) {
+      FS_Status_t status;
+      total_ns += timed_read("data.bin", &status);
+      if (status != FS_Status_Ok) {
+        failed++;
+      } else if (memcmp(bit_error_data, bit_error_read_buffer,
+                        sizeof(bit_error_data)) == 0) {
+        intact[r]++;
+      }
+    }
+
+    FAKE_MEMORY_IO_Stats_t stats;
+    FAKE_MEMORY_IO_get_stats(&stats);
+    char report[160];
+    snprintf(report, sizeof(report),
+             "bit error rate %g: %d intact, %d corrupted, %d failed, "
+             "%u bits flipped, %.0f KiB/s of intact data",
+             rates[r], intact[r], reads - intact[r] - failed, failed,
+             (unsigned)stats.bit_flips,
+             kib_per_s((uint64_t)intact[r] * sizeof(bit_error_data),
+                       total_ns));
+    UT_PRINT(report);
+  }
+
+  LONGS_EQUAL(reads, intact[0]);
+  CHECK(intact[3] < reads);
+}
+
+// clang-format off
+TEST_GROUP(File__system__trace)
+{
+    FILE *stream;
+
+    void setup() {
+        start_blank();
+        stream = tmpfile();
+        CHECK(stream != nullptr);
+    }
+
+    void teardown() {
+        BLOCK_TRACE_stop();
+        fclose(stream);
+    }
+};
+// clang-format on
+
+static uint64_t replay_trace(FILE *stream, const uint8_t *initial_image,
+                             uint32_t page_prog_us,
+                             BLOCK_TRACE_Replay_Result_t *result) {
+  FAKE_MEMORY_IO_Timing_t timing;
+
+  memcpy(memory_buffer, initial_image, sizeof(memory_buffer));
+  memory_image = nullptr;
+  FAKE_MEMORY_IO_set_buffer(memory_buffer);
+  FAKE_MEMORY_IO_get_timing(&timing);
+  timing.page_prog_us = page_prog_us;
+  FAKE_MEMORY_IO_set_timing(&timing);
+
+  rewind(stream);
+  CHECK_TRUE(BLOCK_TRACE_replay(stream, result));
+  return FAKE_MEMORY_IO_get_virtual_time_ns();
+}
+
+TEST(File__system__trace, Recorded__workload__replays__with__other__timing) {
+  const char *directory_path = "/tmp/test_folder";
+  const char *file_name = "test_file.bin";
+  uint8_t test_data[4096];
+  uint8_t read_buffer[sizeof(test_data)];
+  memset(test_data, 0x42, sizeof(test_data));
+  // Program the first blocks, so some erases are done and others skipped
+  memset(memory_buffer, 0x00, 8 * 4096);
+  memory_image = nullptr;
+  static uint8_t initial_image[sizeof(memory_buffer)];
+  memcpy(initial_image, memory_buffer, sizeof(memory_buffer));
+
+  CHECK_TRUE(BLOCK_TRACE_record(stream, FAKE_MEMORY_IO_get_virtual_time_ns,
+                                true));
+  FS_init();
+  FS_create_folder(directory_path);
+  FS_save_to_file(directory_path, file_name, test_data, sizeof(test_data));
+  FS_read_from_file(directory_path, file_name, read_buffer);
+  FS_Stats_t stats;
+  FS_get_stats(&stats);
+  FS_deinit();
+  CHECK_TRUE(BLOCK_TRACE_stop());
+  static uint8_t recorded_image[sizeof(memory_buffer)];
+  memcpy(recorded_image, memory_buffer, sizeof(memory_buffer));
+
+  FAKE_MEMORY_IO_Timing_t timing;
+  FAKE_MEMORY_IO_get_timing(&timing);
+  BLOCK_TRACE_Replay_Result_t typical;
+  BLOCK_TRACE_Replay_Result_t slow;
+  uint64_t typical_ns =
+      replay_trace(stream, initial_image, timing.page_prog_us, &typical);
+  MEMCMP_EQUAL(recorded_image, memory_buffer, sizeof(memory_buffer));
+  uint64_t slow_ns =
+      replay_trace(stream, initial_image, timing.page_prog_us * 4U, &slow);
+
+  CHECK(typical.reads > 0U);
+  CHECK(typical.progs > 0U);
+  CHECK(typical.erases > 0U);
+  CHECK(stats.erases_avoided > 0U);
+  UNSIGNED_LONGS_EQUAL(stats.erases_requested - stats.erases_avoided,
+                       typical.erases);
+  CHECK(typical.syncs > 0U);
+  CHECK(typical.bytes_programmed >= sizeof(test_data));
+  CHECK(typical.recorded_ns > 0U);
+  UNSIGNED_LONGS_EQUAL(0, typical.failures);
+  UNSIGNED_LONGS_EQUAL(typical.progs, slow.progs);
+  UNSIGNED_LONGS_EQUAL(0, slow.failures);
+  CHECK(slow_ns > typical_ns);
+}
+
 static void load_binary_image(const char *filepath) {
   FILE *file = fopen(filepath, "rb");
   if (file == nullptr) {
@@ -272,4 +1630,5 @@ static void load_binary_image(const char *filepath) {
   }
   fread(memory_buffer, 1, sizeof(memory_buffer), file);
   fclose(file);
+  memory_image = nullptr;
 }
\ No newline at end of file
@@ -0,0 +1,144 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "power_loss_sweep.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static void sweep_start(uint8_t *memory, const uint8_t *image, uint32_t size) {
+  memcpy(memory, image, size);
+  FAKE_MEMORY_IO_set_buffer(memory);
+}
+
+/* After the first cut point, a worker only rewrites the sectors the previous
+ * run modified, through a snapshot of the image. */
+static void sweep_worker(uint8_t *memory, const uint8_t *image, uint32_t size,
+                         FAKE_MEMORY_IO_Cut_Mode_t mode,
+                         void (*workload)(void), bool (*check)(void),
+                         uint32_t first, uint32_t step, uint32_t cut_points,
+                         uint8_t *failed) {
+  uint8_t *snapshot = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  bool snapshot_taken = false;
+
+  sweep_start(memory, image, size);
+  if (snapshot != MAP_FAILED) {
+    snapshot_taken = FAKE_MEMORY_IO_take_snapshot(snapshot);
+  }
+
+  for (uint32_t cut = first; cut < cut_points; cut += step) {
+    if (snapshot_taken) {
+      FAKE_MEMORY_IO_restore_snapshot();
+    } else if (cut != first) {
+      sweep_start(memory, image, size);
+    }
+    FAKE_MEMORY_IO_set_power_cut(cut, mode);
+    workload();
+    FAKE_MEMORY_IO_restore_power();
+    failed[cut] = check() ? 0U : 1U;
+  }
+
+  if (snapshot != MAP_FAILED) {
+    munmap(snapshot, size);
+  }
+}
+
+bool POWER_LOSS_sweep(uint8_t *memory, const uint8_t *image, uint32_t size,
+                      FAKE_MEMORY_IO_Cut_Mode_t mode, void (*workload)(void),
+                      bool (*check)(void), unsigned jobs,
+                      POWER_LOSS_Result_t *result) {
+  memset(result, 0, sizeof(*result));
+
+  sweep_start(memory, image, size);
+  workload();
+  FAKE_MEMORY_IO_Stats_t stats;
+  FAKE_MEMORY_IO_get_stats(&stats);
+  uint32_t cut_points = stats.page_programs + stats.erase_commands;
+  result->cut_points = cut_points;
+  if (cut_points == 0U) {
+    return true;
+  }
+
+  if (jobs == 0U) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    jobs = (cpus > 0) ? (unsigned)cpus : 1U;
+  }
+  if (jobs > cut_points) {
+    jobs = cut_points;
+  }
+
+  /* Workers report one byte per cut point through shared memory. */
+  uint8_t *failed = mmap(NULL, cut_points, PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (failed == MAP_FAILED) {
+    return false;
+  }
+  memset(failed, 1, cut_points);
+
+  pid_t *workers = calloc(jobs, sizeof(*workers));
+  if (workers == NULL) {
+    munmap(failed, cut_points);
+    return false;
+  }
+
+  unsigned started = 0;
+  for (; started < jobs; started++) {
+    pid_t pid = fork();
+    if (pid < 0) {
+      break;
+    }
+    if (pid == 0) {
+      sweep_worker(memory, image, size, mode, workload, check, started, jobs,
+                   cut_points, failed);
+      _exit(0);
+    }
+    workers[started] = pid;
+  }
+
+  /* Only the workers are reaped, and one that crashed fails the sweep. */
+  bool ran = (started == jobs);
+  for (unsigned i = 0; i < started; i++) {
+    int status = 0;
+    if (waitpid(workers[i], &status, 0) != workers[i] || !WIFEXITED(status) ||
+        WEXITSTATUS(status) != 0) {
+      ran = false;
+    }
+  }
+  free(workers);
+
+  for (uint32_t cut = 0; ran && cut < cut_points; cut++) {
+    if (failed[cut] != 0U) {
+      if (result->failures == 0U) {
+        result->first_failure = cut;
+      }
+      result->failures++;
+    }
+  }
+
+  munmap(failed, cut_points);
+  return ran;
+}
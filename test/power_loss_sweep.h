@@ -0,0 +1,69 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef POWER_LOSS_SWEEP_H__
+#define POWER_LOSS_SWEEP_H__
+
+#include "fake_memory_io.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Outcome of a power-loss sweep.
+ */
+typedef struct {
+  uint32_t cut_points;    /**< Commands the workload issues, each one cut */
+  uint32_t failures;      /**< Cut points whose check failed */
+  uint32_t first_failure; /**< Lowest failing cut point, if any failed */
+} POWER_LOSS_Result_t;
+
+/**
+ * @brief Run a workload once for every point where power can be cut.
+ *
+ * The workload is first run without faults to count its page program and
+ * erase commands. It is then replayed with power cut during each one of
+ * them, starting every time from the given image. Power is restored after
+ * the workload returns and check() decides whether the memory is in a valid
+ * state, typically by remounting with FS_init().
+ *
+ * Cut points are spread over forked worker processes, each with its own copy
+ * of the fake memory, so the workload and check run in the children.
+ *
+ * @param memory Buffer used as the fake memory.
+ * @param image Contents the memory starts with, of the same size.
+ * @param size Size of the memory in bytes.
+ * @param mode What an interrupted command leaves behind.
+ * @param workload Operations to run, which may fail once power is cut.
+ * @param check Invariants to verify after power is restored.
+ * @param jobs Worker processes to use, 0 for one per online CPU.
+ * @param result Pointer where the outcome will be stored.
+ * @return true if the sweep ran, false if it could not be set up or a worker
+ * did not exit cleanly.
+ */
+bool POWER_LOSS_sweep(uint8_t *memory, const uint8_t *image, uint32_t size,
+                      FAKE_MEMORY_IO_Cut_Mode_t mode, void (*workload)(void),
+                      bool (*check)(void), unsigned jobs,
+                      POWER_LOSS_Result_t *result);
+
+#endif /* POWER_LOSS_SWEEP_H__ */
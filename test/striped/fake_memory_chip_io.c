@@ -0,0 +1,191 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "fake_memory_chip_io.h"
+#include <string.h>
+
+/* Each chip is a GD25Q16C-like device with its own buffer and busy period.
+ * Time is virtual and shared by the chips: it only moves when the caller
+ * waits for a chip, so busy periods of different chips overlap exactly as
+ * the commands were issued. */
+typedef struct {
+  uint8_t *buffer;
+  uint64_t busy_until_us;
+  bool suspended;
+  uint64_t suspended_remaining_us;
+  uint32_t overlaps;
+} Fake_Chip_t;
+
+static Fake_Chip_t fake_chips[FAKE_MEMORY_CHIP_IO_MAX_CHIPS];
+static uint8_t fake_chip_count = 0;
+static MEMIO_Geometry_t fake_chip_geometry = {
+    .jedec_id = 0xC84015,
+    .size = 2U * 1024U * 1024U,
+    .page_size = 256U,
+    .sector_size = 4096U,
+    .block_size = 64U * 1024U,
+};
+static uint32_t fake_prog_busy_us = 0;
+static uint32_t fake_erase_busy_us = 0;
+static uint64_t fake_clock_us = 0;
+
+/* Starts a command on the chip, counting it when another chip is busy. */
+static void fake_start_busy(uint8_t chip, uint64_t busy_us) {
+  for (uint8_t other = 0; other < fake_chip_count; other++) {
+    if (other != chip && MEMCHIP_is_busy(other)) {
+      fake_chips[chip].overlaps++;
+      break;
+    }
+  }
+  fake_chips[chip].busy_until_us = fake_clock_us + busy_us;
+}
+
+void FAKE_MEMORY_CHIP_IO_set_buffers(uint8_t *const *buffers, uint8_t count,
+                                     uint32_t chip_size) {
+  memset(fake_chips, 0, sizeof(fake_chips));
+  for (uint8_t chip = 0; chip < count; chip++) {
+    fake_chips[chip].buffer = buffers[chip];
+  }
+  fake_chip_count = count;
+  fake_chip_geometry.size = chip_size;
+  fake_prog_busy_us = 0;
+  fake_erase_busy_us = 0;
+  fake_clock_us = 0;
+}
+
+void FAKE_MEMORY_CHIP_IO_set_busy_time(uint32_t prog_us, uint32_t erase_us) {
+  fake_prog_busy_us = prog_us;
+  fake_erase_busy_us = erase_us;
+}
+
+uint64_t FAKE_MEMORY_CHIP_IO_get_time_us(void) { return fake_clock_us; }
+
+uint32_t FAKE_MEMORY_CHIP_IO_get_overlaps(uint8_t chip) {
+  return (chip < fake_chip_count) ? fake_chips[chip].overlaps : 0U;
+}
+
+uint8_t MEMCHIP_get_count(void) { return fake_chip_count; }
+
+MEMIO_Status_t MEMCHIP_get_geometry(uint8_t chip, MEMIO_Geometry_t *geometry) {
+  if (chip >= fake_chip_count) {
+    return MEMIO_Status_Err;
+  }
+  *geometry = fake_chip_geometry;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMCHIP_read(uint8_t chip, uint32_t address, void *buffer,
+                            uint32_t size) {
+  if (chip >= fake_chip_count || address + size > fake_chip_geometry.size ||
+      (!fake_chips[chip].suspended && MEMCHIP_is_busy(chip))) {
+    return MEMIO_Status_Err;
+  }
+  memcpy(buffer, &fake_chips[chip].buffer[address], size);
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMCHIP_prog(uint8_t chip, uint32_t address, const void *buffer,
+                            uint32_t size) {
+  if (chip >= fake_chip_count || address + size > fake_chip_geometry.size ||
+      MEMCHIP_is_busy(chip)) {
+    return MEMIO_Status_Err;
+  }
+  for (uint32_t i = 0; i < size; i++) {
+    fake_chips[chip].buffer[address + i] &= ((const uint8_t *)buffer)[i];
+  }
+  fake_start_busy(chip, fake_prog_busy_us);
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMCHIP_erase_range(uint8_t chip, uint32_t address,
+                                   uint32_t length) {
+  uint32_t sector_size = fake_chip_geometry.sector_size;
+  uint32_t block_size = fake_chip_geometry.block_size;
+  if (chip >= fake_chip_count || address % sector_size != 0 ||
+      length % sector_size != 0 || address + length > fake_chip_geometry.size ||
+      MEMCHIP_is_busy(chip)) {
+    return MEMIO_Status_Err;
+  }
+
+  uint32_t commands = 0;
+  memset(&fake_chips[chip].buffer[address], 0xFF, length);
+  while (length > 0) {
+    uint32_t erase_size = sector_size;
+    if (address % block_size == 0 && length >= block_size) {
+      erase_size = block_size;
+    } else if (address % (block_size / 2U) == 0 &&
+               length >= block_size / 2U) {
+      erase_size = block_size / 2U;
+    }
+    address += erase_size;
+    length -= erase_size;
+    commands++;
+  }
+  fake_start_busy(chip, (uint64_t)commands * fake_erase_busy_us);
+  return MEMIO_Status_Ok;
+}
+
+bool MEMCHIP_is_busy(uint8_t chip) {
+  return fake_chips[chip].suspended ||
+         fake_clock_us < fake_chips[chip].busy_until_us;
+}
+
+MEMIO_Status_t MEMCHIP_wait(uint8_t chip) {
+  if (fake_chips[chip].suspended) {
+    return MEMIO_Status_Err;
+  }
+  if (fake_clock_us < fake_chips[chip].busy_until_us) {
+    fake_clock_us = fake_chips[chip].busy_until_us;
+  }
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMCHIP_suspend(uint8_t chip) {
+  if (fake_chips[chip].suspended ||
+      fake_clock_us >= fake_chips[chip].busy_until_us) {
+    return MEMIO_Status_Err;
+  }
+  fake_chips[chip].suspended = true;
+  fake_chips[chip].suspended_remaining_us =
+      fake_chips[chip].busy_until_us - fake_clock_us;
+  return MEMIO_Status_Ok;
+}
+
+MEMIO_Status_t MEMCHIP_resume(uint8_t chip) {
+  if (!fake_chips[chip].suspended) {
+    return MEMIO_Status_Err;
+  }
+  fake_chips[chip].suspended = false;
+  fake_chips[chip].busy_until_us =
+      fake_clock_us + fake_chips[chip].suspended_remaining_us;
+  return MEMIO_Status_Ok;
+}
+
+const void *MEMCHIP_map(uint8_t chip, uint32_t address, uint32_t size) {
+  if (chip >= fake_chip_count || address + size > fake_chip_geometry.size ||
+      MEMCHIP_is_busy(chip)) {
+    return NULL;
+  }
+  return &fake_chips[chip].buffer[address];
+}
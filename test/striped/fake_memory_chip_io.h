@@ -0,0 +1,38 @@
+/**
+ * MIT License
+ *
+ * Copyright (c) 2025 Albert Álvarez Carulla (TheAlbertDev)
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef FAKE_MEMORY_CHIP_IO_H__
+#define FAKE_MEMORY_CHIP_IO_H__
+
+#include "memory_chip_io.h"
+
+#define FAKE_MEMORY_CHIP_IO_MAX_CHIPS 4
+
+void FAKE_MEMORY_CHIP_IO_set_buffers(uint8_t *const *buffers, uint8_t count,
+                                     uint32_t chip_size);
+void FAKE_MEMORY_CHIP_IO_set_busy_time(uint32_t prog_us, uint32_t erase_us);
+uint64_t FAKE_MEMORY_CHIP_IO_get_time_us(void);
+uint32_t FAKE_MEMORY_CHIP_IO_get_overlaps(uint8_t chip);
+
+#endif /* FAKE_MEMORY_CHIP_IO_H__ */
@@ -0,0 +1,176 @@
+#include "CppUTest/TestHarness.h"
+
+extern "C" {
+#include "fake_memory_chip_io.h"
+#include "file_system.h"
+}
+
+#define CHIP_SIZE (4096U * 64U)
+
+static uint8_t chip_buffers[FAKE_MEMORY_CHIP_IO_MAX_CHIPS][CHIP_SIZE];
+
+static void set_up_chips(uint8_t count);
+static uint64_t run_erase_and_program_workload(void);
+
+// clang-format off
+TEST_GROUP(Striped__memory__io)
+{
+    void setup() {
+        set_up_chips(2);
+    }
+};
+// clang-format on
+
+TEST(Striped__memory__io, Geometry__spans__all__chips) {
+  MEMIO_Geometry_t geometry;
+
+  MEMIO_Status_t status = MEMIO_get_geometry(&geometry);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  UNSIGNED_LONGS_EQUAL(2U * CHIP_SIZE, geometry.size);
+  UNSIGNED_LONGS_EQUAL(4096U, geometry.sector_size);
+}
+
+TEST(Striped__memory__io,
+     Consecutive__sectors__are__interleaved__across__chips) {
+  uint8_t data[4096 * 3];
+  uint8_t read_back[sizeof(data)];
+
+  for (size_t i = 0U; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i / 4096U + 1U);
+  }
+
+  MEMIO_Status_t status = MEMIO_prog(0, data, sizeof(data));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  BYTES_EQUAL(1, chip_buffers[0][0]);
+  BYTES_EQUAL(2, chip_buffers[1][0]);
+  BYTES_EQUAL(3, chip_buffers[0][4096]);
+  BYTES_EQUAL(0xFF, chip_buffers[1][4096]);
+
+  status = MEMIO_read(0, read_back, sizeof(read_back));
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  MEMCMP_EQUAL(data, read_back, sizeof(data));
+}
+
+TEST(Striped__memory__io, Erase__range__is__split__between__chips) {
+  memset(chip_buffers[0], 0x00, CHIP_SIZE);
+  memset(chip_buffers[1], 0x00, CHIP_SIZE);
+
+  MEMIO_Status_t status = MEMIO_erase_range(4096, 4096 * 3);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+
+  BYTES_EQUAL(0x00, chip_buffers[0][0]);
+  BYTES_EQUAL(0xFF, chip_buffers[1][0]);
+  BYTES_EQUAL(0xFF, chip_buffers[0][4096]);
+  BYTES_EQUAL(0xFF, chip_buffers[1][4095]);
+  BYTES_EQUAL(0xFF, chip_buffers[1][4096]);
+  BYTES_EQUAL(0x00, chip_buffers[0][8192]);
+}
+
+TEST(Striped__memory__io, Blank__check__covers__every__chip) {
+  bool erased = false;
+
+  MEMIO_Status_t status = MEMIO_is_erased(0, 4096 * 2, &erased);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_TRUE(erased);
+
+  chip_buffers[1][100] = 0x00;
+  status = MEMIO_is_erased(0, 4096 * 2, &erased);
+  CHECK_EQUAL(MEMIO_Status_Ok, status);
+  CHECK_FALSE(erased);
+}
+
+TEST(Striped__memory__io, Map__only__returns__extents__within__one__sector) {
+  const void *mapped = MEMIO_map(4096 + 16, 64);
+  POINTERS_EQUAL(&chip_buffers[1][16], mapped);
+
+  mapped = MEMIO_map(4096 - 16, 64);
+  POINTERS_EQUAL(nullptr, mapped);
+}
+
+TEST(Striped__memory__io, Operations__fail__without__chips) {
+  uint8_t data[16] = {0};
+
+  set_up_chips(0);
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase(4096));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_erase_async(4096, NULL, NULL));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_read(0, data, sizeof(data)));
+  CHECK_EQUAL(MEMIO_Status_Err, MEMIO_prog(0, data, sizeof(data)));
+  POINTERS_EQUAL(nullptr, MEMIO_map(0, sizeof(data)));
+}
+
+TEST(Striped__memory__io, Throughput__scales__with__chip__count) {
+  set_up_chips(1);
+  uint64_t one_chip_us = run_erase_and_program_workload();
+  UNSIGNED_LONGS_EQUAL(0, FAKE_MEMORY_CHIP_IO_get_overlaps(0));
+
+  /* Every chip works while another one is busy */
+  set_up_chips(4);
+  uint64_t four_chips_us = run_erase_and_program_workload();
+  for (uint8_t chip = 0; chip < 4; chip++) {
+    CHECK(FAKE_MEMORY_CHIP_IO_get_overlaps(chip) > 0U);
+  }
+  CHECK(four_chips_us * 2U < one_chip_us);
+}
+
+TEST(Striped__memory__io, File__system__runs__on__striped__memory) {
+  const char *directory_path = "/data";
+  const char *file_name = "file.bin";
+  uint8_t data[10000];
+  uint8_t read_back[sizeof(data)];
+
+  for (size_t i = 0U; i < sizeof(data); i++) {
+    data[i] = (uint8_t)(i * 31U);
+  }
+
+  FS_Status_t status = FS_init();
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  FS_create_folder(directory_path);
+  status = FS_save_to_file(directory_path, file_name, data, sizeof(data));
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  status = FS_deinit();
+  CHECK_EQUAL(FS_Status_Ok, status);
+  status = FS_init();
+  CHECK_EQUAL(FS_Status_Ok, status);
+
+  memset(read_back, 0, sizeof(read_back));
+  status = FS_read_from_file(directory_path, file_name, read_back);
+  CHECK_EQUAL(FS_Status_Ok, status);
+  MEMCMP_EQUAL(data, read_back, sizeof(data));
+
+  status = FS_deinit();
+  CHECK_EQUAL(FS_Status_Ok, status);
+}
+
+static void set_up_chips(uint8_t count) {
+  uint8_t *buffers[FAKE_MEMORY_CHIP_IO_MAX_CHIPS];
+
+  for (uint8_t chip = 0; chip < count; chip++) {
+    memset(chip_buffers[chip], 0xFF, CHIP_SIZE);
+    buffers[chip] = chip_buffers[chip];
+  }
+  FAKE_MEMORY_CHIP_IO_set_buffers(buffers, count, CHIP_SIZE);
+}
+
+/* Erases 8 sectors that are not block aligned and programs one page in each
+ * of them, the pattern lfs produces when it allocates consecutive blocks. */
+static uint64_t run_erase_and_program_workload(void) {
+  uint8_t page[256];
+  MEMIO_Extent_t extents[8];
+
+  memset(page, 0x5A, sizeof(page));
+  for (uint32_t i = 0U; i < 8U; i++) {
+    extents[i].address = (i + 1U) * 4096U;
+    extents[i].buffer = page;
+    extents[i].size = sizeof(page);
+  }
+
+  FAKE_MEMORY_CHIP_IO_set_busy_time(500, 2000);
+
+  uint64_t start_us = FAKE_MEMORY_CHIP_IO_get_time_us();
+  MEMIO_erase_range(4096, 8 * 4096);
+  MEMIO_progv(extents, 8);
+  return FAKE_MEMORY_CHIP_IO_get_time_us() - start_us;
+}